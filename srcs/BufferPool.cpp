@@ -0,0 +1,111 @@
+#include "BufferPool.hpp"
+#include <cstring>
+
+BufferPool::BufferPool() {}
+
+BufferPool::~BufferPool() {
+  for (int sizeClass = 0; sizeClass < classes; sizeClass++) {
+    for (size_t i = 0; i < freeLists[sizeClass].size(); i++)
+      delete[] freeLists[sizeClass][i];
+  }
+}
+
+size_t BufferPool::classSize(int sizeClass) { return minSize << sizeClass; }
+
+char *BufferPool::acquire(int sizeClass) {
+  std::vector<char *> &freeList = freeLists[sizeClass];
+  if (freeList.empty() == true)
+    return new char[classSize(sizeClass)];
+  char *data = freeList.back();
+  freeList.pop_back();
+  return data;
+}
+
+void BufferPool::release(char *data, int sizeClass) {
+  std::vector<char *> &freeList = freeLists[sizeClass];
+  if (freeList.size() * classSize(sizeClass) >= maxCachedBytes) {
+    delete[] data;
+    return;
+  }
+  freeList.push_back(data);
+}
+
+ReadBuffer::ReadBuffer()
+    : pool(NULL), data(NULL), sizeClass(-1), hint(0), start(0), end(0) {}
+
+ReadBuffer::~ReadBuffer() { release(); }
+
+void ReadBuffer::attach(BufferPool *pool) { this->pool = pool; }
+
+bool ReadBuffer::reserve() {
+  if (data == NULL) {
+    sizeClass = hint;
+    data = pool->acquire(sizeClass);
+    start = 0;
+    end = 0;
+    return true;
+  }
+  if (space() > 0)
+    return true;
+  // Move the unparsed rest of a request to the front before growing
+  if (start > 0) {
+    std::memmove(data, data + start, end - start);
+    end -= start;
+    start = 0;
+    return true;
+  }
+  if (sizeClass + 1 >= BufferPool::classes)
+    return false;
+  char *grown = pool->acquire(sizeClass + 1);
+  std::memcpy(grown, data, end);
+  pool->release(data, sizeClass);
+  data = grown;
+  sizeClass++;
+  return true;
+}
+
+char *ReadBuffer::tail() { return data + end; }
+
+size_t ReadBuffer::space() const {
+  if (data == NULL)
+    return 0;
+  return BufferPool::classSize(sizeClass) - end;
+}
+
+void ReadBuffer::produced(size_t count) {
+  if (count == space() && hint + 1 < BufferPool::classes)
+    hint++;
+  end += count;
+}
+
+std::string_view ReadBuffer::view() const {
+  if (data == NULL)
+    return std::string_view();
+  return std::string_view(data + start, end - start);
+}
+
+void ReadBuffer::consume(size_t count) {
+  start += count;
+  if (start >= end) {
+    start = 0;
+    end = 0;
+  }
+}
+
+size_t ReadBuffer::size() const { return end - start; }
+
+bool ReadBuffer::empty() const { return start == end; }
+
+void ReadBuffer::shrink() {
+  if (data == NULL || empty() == false)
+    return;
+  pool->release(data, sizeClass);
+  data = NULL;
+  sizeClass = -1;
+}
+
+void ReadBuffer::release() {
+  start = end;
+  shrink();
+  hint = 0;
+}
@@ -0,0 +1,70 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+// Free lists of read buffers in power of two size classes, 4 KB to 128 KB.
+// One pool per event loop, so no locking. Each class keeps at most
+// maxCachedBytes of released buffers, the rest goes back to the allocator.
+class BufferPool {
+	public:
+	static const int classes = 6;
+	static const size_t minSize = 4096;
+	static const size_t maxCachedBytes = 1024 * 1024;
+
+	BufferPool();
+	~BufferPool();
+
+	static size_t classSize(int sizeClass);
+	char *acquire(int sizeClass);
+	void release(char *data, int sizeClass);
+
+	private:
+	std::vector<char *> freeLists[classes];
+
+	BufferPool(const BufferPool &);
+	BufferPool &operator=(const BufferPool &);
+};
+
+// Per connection input buffer. recv writes into the free tail, the parser
+// reads view() in place and consume()s what it used. The memory goes back to
+// the pool as soon as everything was consumed, so an idle keep-alive
+// connection holds no buffer. A connection whose reads keep filling the
+// buffer gets a larger size class on the next acquire.
+class ReadBuffer {
+	private:
+	BufferPool *pool;
+	char *data;
+	int sizeClass; // class of data, -1 when no buffer is held
+	int hint;      // class to acquire next
+	size_t start;  // first unconsumed byte
+	size_t end;    // one past the last received byte
+
+	ReadBuffer(const ReadBuffer &);
+	ReadBuffer &operator=(const ReadBuffer &);
+
+	public:
+	ReadBuffer();
+	~ReadBuffer();
+
+	void attach(BufferPool *pool);
+	// Makes room for the next recv, false when the largest class is full
+	bool reserve();
+	char *tail();
+	size_t space() const;
+	void produced(size_t count);
+
+	std::string_view view() const;
+	void consume(size_t count);
+	size_t size() const;
+	bool empty() const;
+	// Hands the memory back to the pool if nothing is left to parse
+	void shrink();
+	// Drops what is buffered and hands the memory back, for a closed
+	// connection whose state is reused
+	void release();
+};
+
+#endif // BUFFER_POOL_HPP
@@ -0,0 +1,109 @@
+#include "ChunkedDecoder.hpp"
+
+// 15 hex digits keep a chunk size well inside 64 bits
+static const int maxSizeDigits = 15;
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+ChunkedDecoder::ChunkedDecoder() { reset(); }
+
+ChunkedDecoder::~ChunkedDecoder() {}
+
+void ChunkedDecoder::reset() {
+  state = SIZE;
+  remaining = 0;
+  digits = 0;
+}
+
+ChunkedDecoder::Result ChunkedDecoder::decode(std::string_view input,
+                                              size_t &used,
+                                              std::string_view &data) {
+  used = 0;
+  data = std::string_view();
+  while (state != FINISHED && state != FAILED) {
+    if (state == CHUNK_DATA) {
+      if (used == input.size())
+        return NEED_MORE;
+      size_t available = input.size() - used;
+      size_t take = remaining < available ? remaining : available;
+      data = input.substr(used, take);
+      used += take;
+      remaining -= take;
+      if (remaining == 0)
+        state = DATA_CR;
+      return DATA;
+    }
+    if (used == input.size())
+      return NEED_MORE;
+
+    char c = input[used++];
+    switch (state) {
+    case SIZE: {
+      int value = hexValue(c);
+      if (value >= 0 && digits < maxSizeDigits) {
+        remaining = remaining * 16 + value;
+        digits++;
+      } else if (digits > 0 && (c == ';' || c == ' ' || c == '\t')) {
+        state = EXTENSION;
+      } else if (digits > 0 && c == '\r') {
+        state = SIZE_LF;
+      } else if (digits > 0 && c == '\n') {
+        state = remaining == 0 ? TRAILER_START : CHUNK_DATA;
+      } else {
+        state = FAILED;
+      }
+      break;
+    }
+    case EXTENSION:
+      if (c == '\r')
+        state = SIZE_LF;
+      else if (c == '\n')
+        state = remaining == 0 ? TRAILER_START : CHUNK_DATA;
+      break;
+    case SIZE_LF:
+      if (c != '\n')
+        state = FAILED;
+      else
+        state = remaining == 0 ? TRAILER_START : CHUNK_DATA;
+      break;
+    case DATA_CR:
+      if (c == '\r')
+        state = DATA_LF;
+      else if (c == '\n')
+        state = SIZE;
+      else
+        state = FAILED;
+      digits = 0;
+      break;
+    case DATA_LF:
+      state = c == '\n' ? SIZE : FAILED;
+      break;
+    case TRAILER_START:
+      if (c == '\r')
+        state = LAST_LF;
+      else if (c == '\n')
+        state = FINISHED;
+      else
+        state = TRAILER_LINE;
+      break;
+    case TRAILER_LINE:
+      if (c == '\n')
+        state = TRAILER_START;
+      break;
+    case LAST_LF:
+      state = c == '\n' ? FINISHED : FAILED;
+      break;
+    default:
+      break;
+    }
+  }
+  return state == FINISHED ? DONE : INVALID;
+}
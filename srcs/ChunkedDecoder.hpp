@@ -0,0 +1,48 @@
+#ifndef CHUNKED_DECODER_HPP
+#define CHUNKED_DECODER_HPP
+
+#include <cstdint>
+#include <string_view>
+
+// Streaming decoder for Transfer-Encoding: chunked request bodies. It keeps
+// only its position in the framing, chunk data is handed out as views into
+// the caller's buffer, so memory does not depend on the body or chunk size.
+// Extensions and trailer fields are skipped.
+class ChunkedDecoder {
+	public:
+	enum Result {
+		DATA,      // data holds decoded bytes, call again for more
+		NEED_MORE, // all input used, wait for the next read
+		DONE,      // last chunk and trailers read
+		INVALID
+	};
+
+	ChunkedDecoder();
+	~ChunkedDecoder();
+
+	// Reads framing from input until it reaches chunk data, the end of the
+	// body or the end of input. used is the number of input bytes taken,
+	// data included.
+	Result decode(std::string_view input, size_t &used, std::string_view &data);
+	void reset();
+
+	private:
+	enum State {
+		SIZE,
+		EXTENSION,
+		SIZE_LF,
+		CHUNK_DATA,
+		DATA_CR,
+		DATA_LF,
+		TRAILER_START,
+		TRAILER_LINE,
+		LAST_LF,
+		FINISHED,
+		FAILED
+	};
+	State state;
+	uint64_t remaining; // data bytes left in the current chunk
+	int digits;
+};
+
+#endif // CHUNKED_DECODER_HPP
@@ -0,0 +1,66 @@
+#include "ConnectionTable.hpp"
+
+ConnectionTable::ConnectionTable() : clientCount(0) {}
+
+ConnectionTable::~ConnectionTable() {}
+
+ConnectionTable::Slot &ConnectionTable::slot(int fd) {
+  return chunks[fd / chunkSize][fd % chunkSize];
+}
+
+const ConnectionTable::Slot &ConnectionTable::slot(int fd) const {
+  return chunks[fd / chunkSize][fd % chunkSize];
+}
+
+// Value initialised, so a fresh slot is FD_UNUSED with a zeroed client
+void ConnectionTable::reserve(int fd) {
+  while (static_cast<size_t>(fd) >= chunks.size() * chunkSize)
+    chunks.push_back(std::unique_ptr<Slot[]>(new Slot[chunkSize]()));
+}
+
+void ConnectionTable::addListener(int fd) {
+  reserve(fd);
+  slot(fd).type = FD_LISTENER;
+}
+
+clientState &ConnectionTable::addClient(int fd) {
+  reserve(fd);
+  slot(fd).type = FD_CLIENT;
+  clientCount++;
+  return slot(fd).client;
+}
+
+// Releases what the connection held, its buffer, queued output and files
+void ConnectionTable::remove(int fd) {
+  if (typeOf(fd) == FD_CLIENT) {
+    slot(fd).client.clear();
+    slot(fd).client.readBuffer.release();
+    clientCount--;
+  }
+  if (typeOf(fd) != FD_UNUSED)
+    slot(fd).type = FD_UNUSED;
+}
+
+fdType ConnectionTable::typeOf(int fd) const {
+  if (fd < 0 || static_cast<size_t>(fd) >= chunks.size() * chunkSize)
+    return FD_UNUSED;
+  return slot(fd).type;
+}
+
+bool ConnectionTable::isListener(int fd) const {
+  return typeOf(fd) == FD_LISTENER;
+}
+
+bool ConnectionTable::isClient(int fd) const { return typeOf(fd) == FD_CLIENT; }
+
+clientState *ConnectionTable::find(int fd) {
+  if (typeOf(fd) != FD_CLIENT)
+    return NULL;
+  return &slot(fd).client;
+}
+
+clientState &ConnectionTable::operator[](int fd) { return slot(fd).client; }
+
+size_t ConnectionTable::clients() const { return clientCount; }
+
+int ConnectionTable::end() const { return chunks.size() * chunkSize; }
@@ -0,0 +1,49 @@
+#ifndef CONNECTION_TABLE_HPP
+#define CONNECTION_TABLE_HPP
+
+#include "Structs.hpp"
+#include <memory>
+
+// Flat table indexed by fd. The kernel hands out the lowest free descriptor
+// so the table stays dense, and dispatch, accept and close are all O(1).
+// The clientState lives in the slot itself; slots come in chunks that never
+// move, so references stay valid as the table grows, and a closed
+// connection's state is cleared and reused by the next one on that fd.
+class ConnectionTable {
+	private:
+	static const size_t chunkSize = 1024;
+
+	struct Slot {
+		fdType type;
+		clientState client;
+	};
+	std::vector<std::unique_ptr<Slot[]> > chunks;
+	size_t clientCount;
+
+	Slot &slot(int fd);
+	const Slot &slot(int fd) const;
+	void reserve(int fd);
+
+	ConnectionTable(const ConnectionTable &);
+	ConnectionTable &operator=(const ConnectionTable &);
+
+	public:
+	ConnectionTable();
+	~ConnectionTable();
+
+	void addListener(int fd);
+	clientState &addClient(int fd);
+	void remove(int fd);
+
+	fdType typeOf(int fd) const;
+	bool isListener(int fd) const;
+	bool isClient(int fd) const;
+	// NULL unless fd is a client connection
+	clientState *find(int fd);
+	clientState &operator[](int fd);
+
+	size_t clients() const;
+	int end() const; // one past the highest fd the table has room for
+};
+
+#endif // CONNECTION_TABLE_HPP
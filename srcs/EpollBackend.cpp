@@ -0,0 +1,85 @@
+#ifdef __linux__
+
+#include "EpollBackend.hpp"
+#include <cstring>
+#include <errno.h>
+#include <stdexcept>
+#include <unistd.h>
+
+static const size_t maxEventsPerWait = 1024;
+
+EpollBackend::EpollBackend() : events(maxEventsPerWait) {
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd == -1)
+    throw std::runtime_error("Failed to create epoll instance: " +
+                             std::string(strerror(errno)));
+}
+
+EpollBackend::~EpollBackend() { ::close(epollFd); }
+
+void EpollBackend::control(int op, int fd, short events) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.data.fd = fd;
+  event.events = EPOLLET;
+  if (events & POLLIN)
+    event.events |= EPOLLIN;
+  if (events & POLLOUT)
+    event.events |= EPOLLOUT;
+
+  if (epoll_ctl(epollFd, op, fd, &event) == -1)
+    throw std::runtime_error("epoll_ctl failed on fd " + std::to_string(fd) +
+                             ": " + std::string(strerror(errno)));
+}
+
+void EpollBackend::add(int fd, short events) {
+  control(EPOLL_CTL_ADD, fd, events);
+}
+
+// EPOLL_CTL_MOD re-arms the edge, a fd that is already readable or writable
+// for the new mask reports again on the next wait
+void EpollBackend::modify(int fd, short events) {
+  control(EPOLL_CTL_MOD, fd, events);
+}
+
+// EPOLLEXCLUSIVE avoids waking every worker process for one connection
+void EpollBackend::addShared(int fd) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.data.fd = fd;
+  event.events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+    throw std::runtime_error("epoll_ctl failed on fd " + std::to_string(fd) +
+                             ": " + std::string(strerror(errno)));
+}
+
+void EpollBackend::remove(int fd) {
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+int EpollBackend::wait(std::vector<struct pollfd> &ready, int timeoutMs) {
+  ready.clear();
+  int count = epoll_wait(epollFd, events.data(), events.size(), timeoutMs);
+  if (count <= 0)
+    return (count == -1 && errno == EINTR) ? 0 : count;
+
+  for (int i = 0; i < count; i++) {
+    struct pollfd pollfd = {events[i].data.fd, 0, 0};
+    if (events[i].events & EPOLLIN)
+      pollfd.revents |= POLLIN;
+    if (events[i].events & EPOLLOUT)
+      pollfd.revents |= POLLOUT;
+    if (events[i].events & EPOLLHUP)
+      pollfd.revents |= POLLHUP;
+    if (events[i].events & EPOLLERR)
+      pollfd.revents |= POLLERR;
+    ready.push_back(pollfd);
+  }
+  return count;
+}
+
+bool EpollBackend::isEdgeTriggered() const { return true; }
+
+const char *EpollBackend::name() const { return "epoll"; }
+
+#endif // __linux__
@@ -0,0 +1,33 @@
+#ifndef EPOLL_BACKEND_HPP
+#define EPOLL_BACKEND_HPP
+
+#ifdef __linux__
+
+#include "EventBackend.hpp"
+#include <sys/epoll.h>
+
+// Edge triggered epoll(7) backend, only ready fds are handed back so a wakeup
+// costs O(ready) instead of O(connections)
+class EpollBackend : public EventBackend {
+	private:
+	int epollFd;
+	std::vector<struct epoll_event> events;
+
+	void control(int op, int fd, short events);
+
+	public:
+	EpollBackend();
+	~EpollBackend();
+
+	void add(int fd, short events);
+	void modify(int fd, short events);
+	void remove(int fd);
+	void addShared(int fd);
+	int wait(std::vector<struct pollfd> &ready, int timeoutMs);
+	bool isEdgeTriggered() const;
+	const char *name() const;
+};
+
+#endif // __linux__
+
+#endif // EPOLL_BACKEND_HPP
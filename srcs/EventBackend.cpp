@@ -0,0 +1,54 @@
+#include "EventBackend.hpp"
+#include "EpollBackend.hpp"
+#include "EventLogger.hpp"
+#include "IoUringBackend.hpp"
+#include "OutputQueue.hpp"
+#include "PollBackend.hpp"
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// The config parser already rejected io_uring in a build without it
+EventBackend *EventBackend::create(const std::string &name) {
+#ifdef WEBSERV_IO_URING
+  if (name == "io_uring")
+    return new IoUringBackend();
+#endif
+#ifdef __linux__
+  if (name == "epoll")
+    return new EpollBackend();
+#else
+  if (name == "epoll")
+    WARNING("epoll is not available on this platform, using poll");
+#endif
+  return new PollBackend();
+}
+
+int EventBackend::accept(int listenFd) {
+#ifdef SOCK_NONBLOCK
+  return accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+  int clientSocket = ::accept(listenFd, NULL, NULL);
+  if (clientSocket >= 0 && (fcntl(clientSocket, F_SETFL, O_NONBLOCK) < 0 ||
+                            fcntl(clientSocket, F_SETFD, FD_CLOEXEC) < 0)) {
+    ::close(clientSocket);
+    return -1;
+  }
+  return clientSocket;
+#endif
+}
+
+ssize_t EventBackend::receive(int fd, char *buffer, size_t length) {
+  return recv(fd, buffer, length, 0);
+}
+
+ssize_t EventBackend::send(int fd, OutputQueue &output, bool closeAfter) {
+  (void)closeAfter;
+  return output.flush(fd);
+}
+
+int EventBackend::close(int fd, OutputQueue &output) {
+  (void)output;
+  remove(fd);
+  return ::close(fd);
+}
@@ -0,0 +1,52 @@
+#ifndef EVENT_BACKEND_HPP
+#define EVENT_BACKEND_HPP
+
+#include <poll.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+class OutputQueue;
+
+// Readiness multiplexer used by SocketManager. Every backend reports events
+// with the poll(2) flag values (POLLIN, POLLOUT, POLLHUP, ...) so the
+// connection logic does not care which syscall sits underneath. Socket I/O
+// also goes through the backend, so a completion based backend can hand out
+// the results of requests it submitted instead of running the syscalls.
+class EventBackend {
+	public:
+	virtual ~EventBackend() {}
+
+	// Interest management, events is a mask of POLLIN / POLLOUT
+	virtual void add(int fd, short events) = 0;
+	virtual void modify(int fd, short events) = 0;
+	virtual void remove(int fd) = 0;
+	// Listener shared with other processes, only one of them should wake up
+	virtual void addShared(int fd) { add(fd, POLLIN); }
+	virtual void addListener(int fd) { add(fd, POLLIN); }
+	// Accepted client socket, watched for POLLIN first
+	virtual void addConnection(int fd) { add(fd, POLLIN); }
+
+	// Socket I/O on ready fds, -1 with errno EAGAIN once nothing is left.
+	// closeAfter: output is the last of the connection, the socket may be
+	// closed as soon as it is sent.
+	virtual int accept(int listenFd);
+	virtual ssize_t receive(int fd, char *buffer, size_t length);
+	virtual ssize_t send(int fd, OutputQueue &output, bool closeAfter);
+	// Stops watching and closes fd; output stays alive for as long as a
+	// submitted send may still read from it
+	virtual int close(int fd, OutputQueue &output);
+
+	// Blocks for at most timeoutMs (-1 forever) and fills ready with the fds
+	// that have pending events. Returns the number of ready fds or -1.
+	virtual int wait(std::vector<struct pollfd> &ready, int timeoutMs) = 0;
+
+	// Edge triggered backends only report a transition once, callers have to
+	// drain sockets until EAGAIN
+	virtual bool isEdgeTriggered() const = 0;
+	virtual const char *name() const = 0;
+
+	static EventBackend *create(const std::string &name);
+};
+
+#endif // EVENT_BACKEND_HPP
@@ -26,18 +26,22 @@ std::string EventLogger::getLevel(EventLogger::logLevel color) {
 
 std::string EventLogger::displayTimeStamp(void) {
   std::time_t currentTime = std::time(NULL);
-  std::tm *now = std::localtime(&currentTime);
+  std::tm now;
+  localtime_r(&currentTime, &now);
 
   char fTime[13];
-  std::strftime(fTime, sizeof(fTime), " [%H:%M:%S] ", now);
+  std::strftime(fTime, sizeof(fTime), " [%H:%M:%S] ", &now);
   return std::string(fTime);
 }
 
 void EventLogger::log(const std::string &message, const char *filename,
                       int lineNumber, const std::string &color,
                       logLevel level) {
-  std::cout << color << "[ " << getLevel(level) << " ]"
-            << EventLogger::displayTimeStamp()
-            << "[ " << filename << ":" << lineNumber << " ] : " << message
-            << RESET << std::endl;
+  // One write per line so worker threads do not interleave their output
+  std::ostringstream line;
+  line << color << "[ " << getLevel(level) << " ]"
+       << EventLogger::displayTimeStamp()
+       << "[ " << filename << ":" << lineNumber << " ] : " << message
+       << RESET << "\n";
+  std::cout << line.str() << std::flush;
 }
@@ -0,0 +1,153 @@
+#include "FileCache.hpp"
+#include "TimerQueue.hpp"
+#include "Utils.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+FileCache::FileCache(size_t mmapThreshold)
+    : mmapThreshold(mmapThreshold), used(0), mapped(0), hitCount(0),
+      missCount(0) {}
+
+FileCache::~FileCache() {}
+
+std::shared_ptr<const FileCache::Entry>
+FileCache::find(const std::string &path) {
+  std::unordered_map<std::string, Slot>::iterator slot = slots.find(path);
+  if (slot == slots.end()) {
+    ++missCount;
+    return std::shared_ptr<const Entry>();
+  }
+  long long now = TimerQueue::now();
+  if (now - slot->second.checked >= revalidateMs) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || same(*slot->second.entry, info) == false) {
+      erase(slot);
+      ++missCount;
+      return std::shared_ptr<const Entry>();
+    }
+    slot->second.checked = now;
+  }
+  recent.splice(recent.begin(), recent, slot->second.order);
+  ++hitCount;
+  return slot->second.entry;
+}
+
+std::shared_ptr<const FileCache::Entry>
+FileCache::insert(const std::string &path, int fd, const struct stat &info,
+                  const std::string &contentType) {
+  size_t size = info.st_size;
+  bool mappedEntry = mmapThreshold > 0 && size >= mmapThreshold;
+  if (S_ISREG(info.st_mode) == false || size == 0 ||
+      size > (mappedEntry ? mappedBudget : maxEntrySize))
+    return std::shared_ptr<const Entry>();
+
+  std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+  if (mappedEntry == true) {
+    entry->mapping = map(fd, size);
+    if (!entry->mapping)
+      return std::shared_ptr<const Entry>();
+  } else {
+    std::shared_ptr<std::string> content =
+        std::make_shared<std::string>(size, '\0');
+    size_t done = 0;
+    while (done < size) {
+      ssize_t count = pread(fd, &(*content)[done], size - done, done);
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count <= 0)
+        return std::shared_ptr<const Entry>(); // shrank or failed
+      done += count;
+    }
+    entry->content = content;
+  }
+  entry->contentType = contentType;
+  entry->headers = "Content-Type: " + contentType + "\r\nContent-Length: " +
+                   std::to_string(size) + "\r\n";
+  entry->etag = entityTag(info);
+  entry->validators = "ETag: " + entry->etag + "\r\nLast-Modified: " +
+                      httpDate(info.st_mtim.tv_sec) + "\r\n";
+  entry->size = info.st_size;
+  entry->mtime = info.st_mtim;
+  entry->inode = info.st_ino;
+
+  std::unordered_map<std::string, Slot>::iterator old = slots.find(path);
+  if (old != slots.end())
+    erase(old);
+  size_t &total = mappedEntry ? mapped : used;
+  while (total + size > (mappedEntry ? mappedBudget : budget))
+    evict(mappedEntry);
+  recent.push_front(path);
+  Slot &slot = slots[path];
+  slot.entry = entry;
+  slot.order = recent.begin();
+  slot.checked = TimerQueue::now();
+  total += size;
+  return entry;
+}
+
+// Maps the whole file for sequential sending and starts reading it in, so
+// the first sends do not wait on page faults
+std::shared_ptr<const MappedFile> FileCache::map(int fd, size_t size) {
+  void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    WARNING("Unable to map file: " << strerror(errno));
+    return std::shared_ptr<const MappedFile>();
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+  madvise(data, size, MADV_WILLNEED);
+  return std::make_shared<MappedFile>(static_cast<const char *>(data), size);
+}
+
+// Drops the least recently used entry of one kind, mapped or in memory
+void FileCache::evict(bool mappedEntry) {
+  std::list<std::string>::reverse_iterator it;
+  for (it = recent.rbegin(); it != recent.rend(); it++) {
+    std::unordered_map<std::string, Slot>::iterator slot = slots.find(*it);
+    if (static_cast<bool>(slot->second.entry->mapping) == mappedEntry)
+      return erase(slot);
+  }
+}
+
+bool FileCache::hasSidecar(const std::string &sidecar,
+                           const std::string &original) {
+  long long now = TimerQueue::now();
+  std::unordered_map<std::string, Sidecar>::iterator known =
+      sidecars.find(sidecar);
+  if (known != sidecars.end() && now - known->second.checked < revalidateMs)
+    return known->second.fresh;
+
+  // gzip and brotli give the copy the original's mtime, equal is fresh
+  struct stat compressed;
+  struct stat plain;
+  bool fresh = stat(sidecar.c_str(), &compressed) == 0 &&
+               S_ISREG(compressed.st_mode) &&
+               stat(original.c_str(), &plain) == 0 &&
+               (compressed.st_mtim.tv_sec > plain.st_mtim.tv_sec ||
+                (compressed.st_mtim.tv_sec == plain.st_mtim.tv_sec &&
+                 compressed.st_mtim.tv_nsec >= plain.st_mtim.tv_nsec));
+  if (sidecars.size() >= maxSidecars)
+    sidecars.clear();
+  sidecars[sidecar] = Sidecar{fresh, now};
+  return fresh;
+}
+
+void FileCache::erase(std::unordered_map<std::string, Slot>::iterator slot) {
+  if (slot->second.entry->mapping)
+    mapped -= slot->second.entry->mapping->size;
+  else
+    used -= slot->second.entry->content->size();
+  recent.erase(slot->second.order);
+  slots.erase(slot);
+}
+
+bool FileCache::same(const Entry &entry, const struct stat &info) {
+  return entry.size == info.st_size && entry.inode == info.st_ino &&
+         entry.mtime.tv_sec == info.st_mtim.tv_sec &&
+         entry.mtime.tv_nsec == info.st_mtim.tv_nsec;
+}
+
+unsigned long FileCache::hits() const { return hitCount; }
+
+unsigned long FileCache::misses() const { return missCount; }
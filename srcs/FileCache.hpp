@@ -0,0 +1,85 @@
+#ifndef FILE_CACHE_HPP
+#define FILE_CACHE_HPP
+
+#include "OutputQueue.hpp"
+#include <list>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+
+// Byte budgeted LRU cache of small static files, keyed by resolved path.
+// One cache per event loop, so no locking. Hits hand out the content as a
+// shared string the output queue sends without copying. An entry is checked
+// against the file's size, mtime and inode at most once per revalidateMs,
+// so a hot file costs no system call at all in between.
+// Files of at least mmapThreshold bytes are mapped instead of read, with
+// their own budget. Connections sending one share the mapping, it is
+// unmapped once the cache dropped it and the last of them is done.
+class FileCache {
+	public:
+	static const size_t budget = 8 * 1024 * 1024;
+	static const size_t maxEntrySize = 512 * 1024;
+	static const size_t mappedBudget = 256 * 1024 * 1024;
+	static const long long revalidateMs = 1000;
+	static const size_t maxSidecars = 4096;
+
+	struct Entry {
+		std::shared_ptr<const std::string> content; // null for a mapped file
+		std::shared_ptr<const MappedFile> mapping;
+		std::string contentType;
+		std::string headers;    // Content-Type and Content-Length lines
+		std::string validators; // ETag and Last-Modified lines
+		std::string etag;
+		off_t size;
+		struct timespec mtime;
+		ino_t inode;
+	};
+
+	explicit FileCache(size_t mmapThreshold);
+	~FileCache();
+
+	// Fresh entry for path, null on a miss
+	std::shared_ptr<const Entry> find(const std::string &path);
+	// Reads or maps an open regular file into the cache, null if it does not
+	// fit or changed while it was read
+	std::shared_ptr<const Entry> insert(const std::string &path, int fd,
+	                                    const struct stat &info,
+	                                    const std::string &contentType);
+
+	// True if sidecar, a precompressed copy, exists and is at least as new as
+	// original. Answers, negative ones too, are kept for revalidateMs.
+	bool hasSidecar(const std::string &sidecar, const std::string &original);
+
+	unsigned long hits() const;
+	unsigned long misses() const;
+
+	private:
+	struct Slot {
+		std::shared_ptr<const Entry> entry;
+		std::list<std::string>::iterator order;
+		long long checked; // monotonic ms of the last stat
+	};
+	std::unordered_map<std::string, Slot> slots;
+	std::list<std::string> recent; // most recently used first
+	struct Sidecar {
+		bool fresh;
+		long long checked;
+	};
+	std::unordered_map<std::string, Sidecar> sidecars;
+	size_t mmapThreshold; // 0 when nothing is mapped
+	size_t used;
+	size_t mapped;
+	unsigned long hitCount;
+	unsigned long missCount;
+
+	std::shared_ptr<const MappedFile> map(int fd, size_t size);
+	void evict(bool mappedEntry);
+	void erase(std::unordered_map<std::string, Slot>::iterator slot);
+	static bool same(const Entry &entry, const struct stat &info);
+
+	FileCache(const FileCache &);
+	FileCache &operator=(const FileCache &);
+};
+
+#endif // FILE_CACHE_HPP
@@ -0,0 +1,179 @@
+#include "HeaderTable.hpp"
+#include <array>
+#include <cstring>
+
+namespace {
+
+struct KnownHeader {
+  const char *name;
+  HeaderId id;
+};
+
+// Lower case, the names are matched case-insensitively
+constexpr KnownHeader knownHeaders[] = {
+    {"host", HEADER_HOST},
+    {"content-length", HEADER_CONTENT_LENGTH},
+    {"content-type", HEADER_CONTENT_TYPE},
+    {"content-encoding", HEADER_CONTENT_ENCODING},
+    {"connection", HEADER_CONNECTION},
+    {"keep-alive", HEADER_KEEP_ALIVE},
+    {"transfer-encoding", HEADER_TRANSFER_ENCODING},
+    {"expect", HEADER_EXPECT},
+    {"range", HEADER_RANGE},
+    {"if-range", HEADER_IF_RANGE},
+    {"if-none-match", HEADER_IF_NONE_MATCH},
+    {"if-modified-since", HEADER_IF_MODIFIED_SINCE},
+    {"accept", HEADER_ACCEPT},
+    {"accept-encoding", HEADER_ACCEPT_ENCODING},
+    {"user-agent", HEADER_USER_AGENT},
+    {"cookie", HEADER_COOKIE},
+    {"referer", HEADER_REFERER},
+    {"authorization", HEADER_AUTHORIZATION},
+};
+constexpr size_t knownCount = sizeof(knownHeaders) / sizeof(knownHeaders[0]);
+constexpr size_t slotCount = 32;
+
+constexpr char lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+constexpr size_t length(const char *name) {
+  size_t size = 0;
+  while (name[size] != '\0')
+    size++;
+  return size;
+}
+
+// First byte, last byte and length tell the well-known names apart
+constexpr size_t slotOf(char firstChar, char lastChar, size_t size) {
+  return (static_cast<unsigned char>(lower(firstChar)) +
+          static_cast<unsigned char>(lower(lastChar)) * 15 + size * 2) %
+         slotCount;
+}
+
+constexpr size_t slotOf(const char *name) {
+  return slotOf(name[0], name[length(name) - 1], length(name));
+}
+
+// Index + 1 into knownHeaders per slot, 0 for an empty slot
+constexpr std::array<unsigned char, slotCount> buildSlots() {
+  std::array<unsigned char, slotCount> slots = {};
+  for (size_t i = 0; i < knownCount; i++)
+    slots[slotOf(knownHeaders[i].name)] = static_cast<unsigned char>(i + 1);
+  return slots;
+}
+
+constexpr std::array<unsigned char, slotCount> slots = buildSlots();
+
+constexpr bool isPerfect() {
+  for (size_t i = 0; i < knownCount; i++) {
+    if (slots[slotOf(knownHeaders[i].name)] != i + 1)
+      return false;
+  }
+  return true;
+}
+
+static_assert(isPerfect(), "well-known header names collide in the hash");
+static_assert(knownCount == HEADER_COUNT - 1,
+              "every HeaderId needs a name in knownHeaders");
+
+} // namespace
+
+HeaderTable::HeaderTable() { clear(); }
+
+HeaderTable::~HeaderTable() {}
+
+bool HeaderTable::equalsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (lower(a[i]) != lower(b[i]))
+      return false;
+  }
+  return true;
+}
+
+HeaderId HeaderTable::intern(std::string_view name) {
+  if (name.empty() == true)
+    return HEADER_OTHER;
+  unsigned char slot = slots[slotOf(name.front(), name.back(), name.size())];
+  if (slot == 0)
+    return HEADER_OTHER;
+  const KnownHeader &known = knownHeaders[slot - 1];
+  if (equalsIgnoreCase(name, known.name) == false)
+    return HEADER_OTHER;
+  return known.id;
+}
+
+void HeaderTable::assign(std::string_view head, const RequestParser &parser) {
+  clear();
+  storage.assign(head.data(), head.size());
+  fields.reserve(parser.headers.size());
+  for (size_t i = 0; i < parser.headers.size(); i++) {
+    const RequestParser::Header &header = parser.headers[i];
+    Field field;
+    field.id = intern(RequestParser::view(head, header.name));
+    field.nameOffset = header.name.offset;
+    field.nameLength = header.name.length;
+    field.valueOffset = header.value.offset;
+    field.valueLength = header.value.length;
+    fields.push_back(field);
+    if (field.id == HEADER_OTHER)
+      continue;
+    if (first[field.id] == 0)
+      first[field.id] = static_cast<int16_t>(fields.size());
+    if (counts[field.id] < UINT8_MAX)
+      counts[field.id]++;
+  }
+}
+
+void HeaderTable::clear() {
+  storage.clear();
+  fields.clear();
+  std::memset(first, 0, sizeof(first));
+  std::memset(counts, 0, sizeof(counts));
+}
+
+bool HeaderTable::has(HeaderId id) const { return first[id] != 0; }
+
+size_t HeaderTable::count(HeaderId id) const { return counts[id]; }
+
+bool HeaderTable::consistent(HeaderId id) const {
+  if (counts[id] < 2)
+    return true;
+  std::string_view expected = get(id);
+  for (size_t i = first[id]; i < fields.size(); i++) {
+    if (fields[i].id == id && value(i) != expected)
+      return false;
+  }
+  return true;
+}
+
+std::string_view HeaderTable::get(HeaderId id) const {
+  if (first[id] == 0)
+    return std::string_view();
+  return value(first[id] - 1);
+}
+
+std::string_view HeaderTable::get(std::string_view name) const {
+  HeaderId id = intern(name);
+  if (id != HEADER_OTHER)
+    return get(id);
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (fields[i].id == HEADER_OTHER && equalsIgnoreCase(this->name(i), name))
+      return value(i);
+  }
+  return std::string_view();
+}
+
+size_t HeaderTable::size() const { return fields.size(); }
+
+std::string_view HeaderTable::name(size_t index) const {
+  return std::string_view(storage).substr(fields[index].nameOffset,
+                                          fields[index].nameLength);
+}
+
+std::string_view HeaderTable::value(size_t index) const {
+  return std::string_view(storage).substr(fields[index].valueOffset,
+                                          fields[index].valueLength);
+}
@@ -0,0 +1,78 @@
+#ifndef HEADER_TABLE_HPP
+#define HEADER_TABLE_HPP
+
+#include "RequestParser.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Header fields the server acts on, recognised while the head is stored
+enum HeaderId {
+  HEADER_OTHER = 0,
+  HEADER_HOST,
+  HEADER_CONTENT_LENGTH,
+  HEADER_CONTENT_TYPE,
+  HEADER_CONTENT_ENCODING,
+  HEADER_CONNECTION,
+  HEADER_KEEP_ALIVE,
+  HEADER_TRANSFER_ENCODING,
+  HEADER_EXPECT,
+  HEADER_RANGE,
+  HEADER_IF_RANGE,
+  HEADER_IF_NONE_MATCH,
+  HEADER_IF_MODIFIED_SINCE,
+  HEADER_ACCEPT,
+  HEADER_ACCEPT_ENCODING,
+  HEADER_USER_AGENT,
+  HEADER_COOKIE,
+  HEADER_REFERER,
+  HEADER_AUTHORIZATION,
+  HEADER_COUNT
+};
+
+// Request header fields of one request, stored flat: the head is copied once
+// into storage (its capacity is reused by the next request on the
+// connection) and fields are offsets into it. Well-known names are interned
+// to a HeaderId, so their lookups are a single array read.
+class HeaderTable {
+	public:
+	struct Field {
+		HeaderId id;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t valueOffset;
+		uint32_t valueLength;
+	};
+
+	HeaderTable();
+	~HeaderTable();
+
+	// Case-insensitive, O(1): a perfect hash over the well-known names
+	static HeaderId intern(std::string_view name);
+	static bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+	void assign(std::string_view head, const RequestParser &parser);
+	void clear();
+
+	bool has(HeaderId id) const;
+	// Fields with that name, a field may be repeated
+	size_t count(HeaderId id) const;
+	// Whether every repeat of the field carries the first one's value
+	bool consistent(HeaderId id) const;
+	// First field with that name, an empty view when it is missing
+	std::string_view get(HeaderId id) const;
+	std::string_view get(std::string_view name) const;
+
+	size_t size() const;
+	std::string_view name(size_t index) const;
+	std::string_view value(size_t index) const;
+
+	private:
+	std::string storage;
+	std::vector<Field> fields;
+	int16_t first[HEADER_COUNT]; // index + 1 of the first field, 0 if none
+	uint8_t counts[HEADER_COUNT]; // saturates at 255
+};
+
+#endif // HEADER_TABLE_HPP
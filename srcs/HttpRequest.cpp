@@ -12,75 +12,230 @@
 
 #include "HttpRequest.hpp"
 
+// Body bytes an early answer still reads and drops to keep the connection
+static const size_t maxDiscardedBody = 1 << 20;
+
 HttpRequest::HttpRequest() {}
 
 HttpRequest::~HttpRequest() {}
 
-void HttpRequest::requestBlock(clientState &clientData, std::vector<ServerParser> &servers) {
+void HttpRequest::requestBlock(clientState &clientData, const VhostIndex &vhosts) {
+	// The body of a request that was answered early is dropped as it arrives
+	if (clientData.discardBody > 0) {
+		size_t drop = std::min(clientData.discardBody, clientData.readBuffer.size());
+		clientData.readBuffer.consume(drop);
+		clientData.discardBody -= drop;
+		if (clientData.discardBody > 0)
+			return;
+	}
+	std::string_view data = clientData.readBuffer.view();
+
 	if (clientData.flagHeaderRead == false) {
-		std::string::size_type reqMethodPos = clientData.readString.find("\r\n");
-		if (reqMethodPos != std::string::npos) {
-			std::string requestLine = clientData.readString.substr(0, reqMethodPos);
-
-			parseRequestLine(clientData, requestLine);
-			std::string::size_type headerEndPos = clientData.readString.find("\r\n\r\n");
-
-			if (headerEndPos != std::string::npos && headerEndPos > reqMethodPos + 2) {
-				std::string reqHeader = clientData.readString.substr(reqMethodPos + 2, headerEndPos - (reqMethodPos + 2));
-				parseRequestHeader(clientData, reqHeader);
-				clientData.flagHeaderRead = true;
-				clientData.bodyString.append(clientData.readString.substr(headerEndPos + 4));
-				clientData.readString.clear();
-			}
+		// The parser resumes where the last read stopped, a head split across
+		// reads stays in the buffer until it is complete
+		RequestParser::Result result = clientData.parser.parse(data);
+		if (result == RequestParser::INCOMPLETE)
+			return;
+		clientData.flagHeaderRead = true;
+		if (result == RequestParser::INVALID)
+			clientData.requestError = 400;
+		else {
+			parseRequestLine(clientData, data);
+			parseRequestHeader(clientData, data);
 		}
-
-		auto hostIt = clientData.header.find("Host");
-
-		if (hostIt == clientData.header.end())
+		if (clientData.requestError != 0) {
+			WARNING("Rejected request with " << clientData.requestError << " on socket: " << clientData.socketFd);
+			rejectRequest(clientData);
 			return;
+		}
+		clientData.readBuffer.consume(clientData.parser.length);
+		data = clientData.readBuffer.view();
 
-		std::regex pattern(R"(([^:]+):(\d+))");
-		std::smatch matches;
-		std::string domain;
-		int port = 0;
-
-		if (std::regex_match(clientData.header["Host"], matches, pattern)) {
-			domain = matches[1].str();
-			port = std::stoi(matches[2].str());
+		if (clientData.headers.has(HEADER_HOST))
+			clientData.serverData = vhosts.find(clientData.listenFd, clientData.headers.get(HEADER_HOST));
+		else
+			clientData.serverData = vhosts.defaultServer(clientData.listenFd);
+		INFO("Request: " + clientData.requestLine[0] + " url: " + clientData.requestLine[1] + " on: " << clientData.socketFd);
 
-			for (auto &server : servers) {
-				if (server.server_name == domain && server.listen == port) {
-					clientData.serverData = server;
-					break;
-				}
+		bool hasBody = clientData.isChunked || clientData.contentLength > 0;
+		bool expectContinue = false;
+		if (clientData.headers.has(HEADER_EXPECT)) {
+			if (HeaderTable::equalsIgnoreCase(clientData.headers.get(HEADER_EXPECT), "100-continue") == false) {
+				clientData.requestError = 417;
+				rejectRequest(clientData);
+				return;
 			}
+			expectContinue = hasBody && clientData.requestLine[2] == "HTTP/1.1";
 		}
-		INFO("Request: " + clientData.requestLine[0] + " url: " + clientData.requestLine[1] + " on: " << clientData.socketFd);
-	} else if (!clientData.flagBodyRead) {
-		clientData.bodyString.append(clientData.readString);
+		if (hasBody && refuseBody(clientData)) {
+			// A client told to wait may send the body or not, so the
+			// connection cannot be framed after the answer
+			bool unknown = expectContinue || clientData.isChunked;
+			skipBody(clientData, unknown ? SIZE_MAX : clientData.contentLength);
+			return;
+		}
+		// The client holds the body back until it knows it is wanted
+		if (expectContinue && clientData.readBuffer.empty())
+			clientData.output.append(std::string("HTTP/1.1 100 Continue\r\n\r\n"));
+		if (hasBody && isCgi(clientData) && openBodyFile(clientData) == false) {
+			rejectRequest(clientData);
+			return;
+		}
+		if (hasBody && isUpload(clientData)) {
+			std::string boundary = MultipartUpload::boundaryOf(clientData.headers.get(HEADER_CONTENT_TYPE));
+			if (boundary.empty() == false)
+				clientData.upload.begin(boundary, "./www/upload/");
+		}
+	}
+	if (clientData.flagBodyRead == true)
+		return;
+	if (clientData.isChunked == true) {
+		readChunkedBody(clientData);
+		return;
+	}
+	if (clientData.headers.has(HEADER_CONTENT_LENGTH) == false) {
+		clientData.flagBodyRead = true;
+		return;
 	}
+	// Bytes past the body belong to the next pipelined request
+	size_t missing = clientData.contentLength - clientData.bodySize;
+	size_t take = std::min(missing, data.size());
+	storeBody(clientData, data.substr(0, take));
+	clientData.readBuffer.consume(take);
+	if (static_cast<ssize_t>(clientData.bodySize) == clientData.contentLength)
+		clientData.flagBodyRead = true;
+}
+
+// Decodes straight out of the read buffer, the chunk data is stored and its
+// framing dropped without assembling the raw body anywhere
+void HttpRequest::readChunkedBody(clientState &clientData) {
+	std::string_view data = clientData.readBuffer.view();
 
-	std::map<std::string, std::string>::iterator contentLengthIt = clientData.header.find("Content-Length");
-	if (contentLengthIt != clientData.header.end()) {
-		clientData.contentLength = static_cast<ssize_t>(std::atol(contentLengthIt->second.c_str()));
-		if (clientData.contentLength > static_cast<ssize_t>(clientData.serverData.client_body_size)) {
-			clientData.flagFileSizeTooBig = true;
+	while (true) {
+		size_t used = 0;
+		std::string_view piece;
+		ChunkedDecoder::Result result = clientData.chunked.decode(data, used, piece);
+		storeBody(clientData, piece);
+		clientData.readBuffer.consume(used);
+		data.remove_prefix(used);
+		// Where a chunked body ends is unknown, answer now and close
+		if (clientData.flagFileSizeTooBig == true) {
+			WARNING("Chunked body over the limit on socket: " << clientData.socketFd);
+			clientData.upload.abort();
+			skipBody(clientData, SIZE_MAX);
+			return;
 		}
-		if (static_cast<ssize_t>(clientData.bodyString.size()) == static_cast<ssize_t>(clientData.contentLength))
+		if (result == ChunkedDecoder::NEED_MORE)
+			return;
+		if (result == ChunkedDecoder::DONE) {
 			clientData.flagBodyRead = true;
-	} else if (clientData.method == POST) {
-		clientData.flagBodyRead = true;
+			return;
+		}
+		if (result == ChunkedDecoder::INVALID) {
+			WARNING("Malformed chunked body on socket: " << clientData.socketFd);
+			clientData.requestError = 400;
+			rejectRequest(clientData);
+			return;
+		}
 	}
-	clientData.readString.clear();
 }
 
-void HttpRequest::parseRequestLine(clientState &clientData, std::string &line) {
-	std::istringstream ss(line);
-	std::string method, url, httpversion;
+// Counts decoded bytes against client_body_size; past the limit the body is
+// dropped and the request answered with 413. Form uploads go to their files
+// as they arrive, other bodies to the CGI's stdin file or to bodyString.
+void HttpRequest::storeBody(clientState &clientData, std::string_view piece) {
+	if (piece.empty() == true)
+		return;
+	clientData.bodySize += piece.size();
+	if (clientData.bodySize > clientData.serverData->client_body_size)
+		clientData.flagFileSizeTooBig = true;
+	if (clientData.flagFileSizeTooBig == true || clientData.requestError != 0) {
+		clientData.upload.abort();
+		return;
+	}
+	if (clientData.upload.active() == true) {
+		clientData.upload.feed(piece);
+		return;
+	}
+	if (!clientData.bodyFile) {
+		clientData.bodyString.append(piece);
+		return;
+	}
+	while (piece.empty() == false) {
+		ssize_t written = write(clientData.bodyFile->fd, piece.data(), piece.size());
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0) {
+			ERROR("Failed to spool request body on socket: " << clientData.socketFd);
+			clientData.requestError = 500;
+			return;
+		}
+		piece.remove_prefix(written);
+	}
+}
+
+// CGI bodies are spooled to an unlinked temporary file that becomes the
+// script's stdin, so memory stays flat whatever the body size
+bool HttpRequest::openBodyFile(clientState &clientData) {
+	int fd = openTempFile();
+	if (fd == -1) {
+		ERROR("Failed to create a request body file: " << strerror(errno));
+		clientData.requestError = 500;
+		return false;
+	}
+	clientData.bodyFile = std::make_shared<OpenFile>(fd);
+	return true;
+}
+
+// The rest of the connection's input cannot be framed, answer and close
+void HttpRequest::rejectRequest(clientState &clientData) {
+	clientData.flagHeaderRead = true;
+	skipBody(clientData, SIZE_MAX);
+}
+
+// Requests answered 413 or 405 whatever their body holds are refused from
+// the head alone, before the body is received
+bool HttpRequest::refuseBody(clientState &clientData) {
+	if (clientData.contentLength > static_cast<ssize_t>(clientData.serverData->client_body_size)) {
+		WARNING("Body of " << clientData.contentLength << " bytes rejected on socket: " << clientData.socketFd);
+		clientData.flagFileSizeTooBig = true;
+		return true;
+	}
+	if (isMethodsAllowed(clientData) == false) {
+		WARNING("Body of a " << clientData.requestLine[0] << " request rejected on socket: " << clientData.socketFd);
+		return true;
+	}
+	return false;
+}
+
+// Completes the request before its body is read. A small remainder is
+// dropped as it arrives and the connection stays open, a larger or unknown
+// one is drained after the answer until the client stops sending.
+void HttpRequest::skipBody(clientState &clientData, size_t remaining) {
+	clientData.flagBodyRead = true;
+	clientData.discardBody = remaining;
+	if (remaining > maxDiscardedBody)
+		clientData.isKeepAlive = false;
+}
+
+bool HttpRequest::isCgi(const clientState &clientData) {
+	return clientData.path.compare(0, 4, "/cgi") == 0;
+}
+
+// Only a POST that will be answered by responsePost may create files
+bool HttpRequest::isUpload(const clientState &clientData) {
+	return clientData.method == POST && isCgi(clientData) == false
+		&& isMethodsAllowed(clientData) && Scanner::isUrlSafe(clientData.path);
+}
 
-	ss >> method;
-	ss >> url;
-	ss >> httpversion;
+// Complete once the head and the whole body, if any, were read
+bool HttpRequest::isComplete(const clientState &clientData) {
+	return clientData.flagHeaderRead == true && clientData.flagBodyRead == true;
+}
+
+void HttpRequest::parseRequestLine(clientState &clientData, std::string_view data) {
+	const RequestParser &parser = clientData.parser;
+	std::string_view method = RequestParser::view(data, parser.method);
 
 	if (method == "POST")
 		clientData.method = POST;
@@ -91,34 +246,43 @@ void HttpRequest::parseRequestLine(clientState &clientData, std::string &line) {
 	else
 		clientData.method = DEFAULT;
 
-	clientData.requestLine.push_back(method);
-	clientData.requestLine.push_back(url);
-	clientData.requestLine.push_back(httpversion);
+	clientData.requestLine.push_back(std::string(method));
+	clientData.requestLine.push_back(std::string(RequestParser::view(data, parser.target)));
+	clientData.requestLine.push_back(std::string(RequestParser::view(data, parser.version)));
+	// Decoded once here, everything after works from the normalized path
+	if (UrlPath::split(clientData.requestLine[1], clientData.path, clientData.query) == false)
+		clientData.requestError = 400;
 }
 
-void HttpRequest::parseRequestHeader(clientState &clientData, std::string &reqheader) {
-	std::istringstream ss(reqheader);
-	std::string line;
-	if (clientData.flagPartiallyRead == false) {
-		while (std::getline(ss, line)) {
-			if (!line.empty() && *line.rbegin() == '\r')
-				line.erase(line.length() - 1);
-			std::size_t pos = line.find(':');
-			if (pos != std::string::npos) {
-				std::string key = line.substr(0, pos);
-				std::string value = line.substr(pos + 1);
-				std::string::iterator it = value.begin();
-				while (it != value.end() && std::isspace(*it))
-					++it;
-				value.erase(value.begin(), it);
-				clientData.contentLength = 0;
-				if (key == "Content-Length")
-					clientData.contentLength = static_cast<ssize_t>(std::atol(value.c_str()));
-				clientData.header.insert(std::make_pair(key, value));
-			}
-		}
-		if (clientData.header.find("Connection") != clientData.header.end() && clientData.header["Connection"] == "keep-alive") {
-			clientData.isKeepAlive = true;
-		}
+void HttpRequest::parseRequestHeader(clientState &clientData, std::string_view data) {
+	clientData.headers.assign(data.substr(0, clientData.parser.length), clientData.parser);
+
+	// A comma list fails the number parse. Repeats that disagree, or a
+	// repeated Transfer-Encoding, would let a proxy in front of the server
+	// frame the body differently, so they are refused as well.
+	if (clientData.headers.has(HEADER_CONTENT_LENGTH)) {
+		std::string_view value = clientData.headers.get(HEADER_CONTENT_LENGTH);
+		std::from_chars_result parsed = std::from_chars(value.data(), value.data() + value.size(), clientData.contentLength);
+		if (value.empty() || parsed.ec != std::errc() || parsed.ptr != value.data() + value.size() || clientData.contentLength < 0)
+			clientData.requestError = 400;
+		if (clientData.headers.consistent(HEADER_CONTENT_LENGTH) == false)
+			clientData.requestError = 400;
+	}
+	// Only chunked is understood, and it has to be the final coding
+	if (clientData.headers.has(HEADER_TRANSFER_ENCODING)) {
+		std::string_view coding = clientData.headers.get(HEADER_TRANSFER_ENCODING);
+		if (clientData.headers.has(HEADER_CONTENT_LENGTH) || clientData.headers.count(HEADER_TRANSFER_ENCODING) > 1)
+			clientData.requestError = 400;
+		else if (HeaderTable::equalsIgnoreCase(coding, "chunked"))
+			clientData.isChunked = true;
+		else
+			clientData.requestError = 501;
 	}
+	// HTTP/1.1 connections persist unless the client asks to close them,
+	// HTTP/1.0 ones only when the client asks to keep them
+	std::string_view connection = clientData.headers.get(HEADER_CONNECTION);
+	if (clientData.requestLine[2] == "HTTP/1.0")
+		clientData.isKeepAlive = HeaderTable::equalsIgnoreCase(connection, "keep-alive");
+	else
+		clientData.isKeepAlive = HeaderTable::equalsIgnoreCase(connection, "close") == false;
 }
@@ -2,6 +2,8 @@
 # define HTTPREQUEST_HPP
 
 #include "Structs.hpp"
+#include "VhostIndex.hpp"
+#include <charconv>
 #include "EventLogger.hpp"
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -16,9 +18,18 @@ class HttpRequest {
 		HttpRequest();
 		~HttpRequest();
 
-		static void	requestBlock(clientState &clientData, std::vector<ServerParser> &servers);
-		static void	parseRequestLine(clientState &clientData, std::string &request);
-		static void	parseRequestHeader(clientState &clientData, std::string &reqheader);
+		static void	requestBlock(clientState &clientData, const VhostIndex &vhosts);
+		static bool	isComplete(const clientState &clientData);
+		static bool	isCgi(const clientState &clientData);
+		static bool	isUpload(const clientState &clientData);
+		static void	readChunkedBody(clientState &clientData);
+		static void	storeBody(clientState &clientData, std::string_view piece);
+		static bool	openBodyFile(clientState &clientData);
+		static void	rejectRequest(clientState &clientData);
+		static bool	refuseBody(clientState &clientData);
+		static void	skipBody(clientState &clientData, size_t remaining);
+		static void	parseRequestLine(clientState &clientData, std::string_view data);
+		static void	parseRequestHeader(clientState &clientData, std::string_view data);
 };
 
 #endif
\ No newline at end of file
@@ -1,47 +1,94 @@
 #include "HttpResponse.hpp"
+#include <random>
 
-HttpResponse::HttpResponse() {}
+// More ranges than this in one request are answered with the whole file
+static const size_t maxRanges = 16;
 
-HttpResponse::~HttpResponse() {}
+static std::string_view trim(std::string_view value) {
+	while (value.empty() == false && (value.front() == ' ' || value.front() == '\t'))
+		value.remove_prefix(1);
+	while (value.empty() == false && (value.back() == ' ' || value.back() == '\t'))
+		value.remove_suffix(1);
+	return value;
+}
 
-std::string HttpResponse::metaData(clientState &clientData) {
-	std::string headerMetaData = "";
-	std::map<std::string, std::string>::iterator hd = clientData.header.begin();
-	while (hd != clientData.header.end()) {
-		if (hd->first == "Content-Length" || hd->first == "Content-Type" || \
-			hd->first == "Connection" || hd->first == "Date" \
-			|| hd->first == "Server" || hd->first == "Range"){
-			clientData.header.erase(hd++);
-		} else {
-			headerMetaData += hd->first + ": " + hd->second + "\r\n";
-			++hd;
+// Quality Accept-Encoding gives coding in thousandths, 0 if it is refused or
+// not listed. A listed coding wins over "*".
+static int codingQuality(std::string_view header, std::string_view coding) {
+	int wildcard = 0;
+	while (header.empty() == false) {
+		size_t comma = header.find(',');
+		std::string_view item = header.substr(0, comma);
+		header.remove_prefix(comma == std::string_view::npos ? header.size() : comma + 1);
+		size_t semicolon = item.find(';');
+		std::string_view name = trim(item.substr(0, semicolon));
+		int quality = 1000;
+		if (semicolon != std::string_view::npos) {
+			std::string_view weight = trim(item.substr(semicolon + 1));
+			if (weight.size() > 2 && (weight[0] == 'q' || weight[0] == 'Q') && weight[1] == '=') {
+				weight.remove_prefix(2);
+				quality = weight[0] == '1' ? 1000 : 0;
+				if (weight[0] == '0' && weight.size() > 2 && weight[1] == '.') {
+					for (size_t i = 2, scale = 100; i < weight.size() && i < 5 && isdigit(weight[i]); i++, scale /= 10)
+						quality += (weight[i] - '0') * scale;
+				}
+			}
 		}
+		if (HeaderTable::equalsIgnoreCase(name, coding))
+			return quality;
+		if (name == "*")
+			wildcard = quality;
 	}
+	return wildcard;
+}
+
+static bool isCompressible(const std::string &contentType) {
+	return contentType.compare(0, 5, "text/") == 0 || contentType.find("javascript") != std::string::npos
+		|| contentType.find("json") != std::string::npos || contentType.find("xml") != std::string::npos;
+}
+
+HttpResponse::HttpResponse(FileCache &cache) : _fileSize(0), _cache(cache), _keepAlive(true) {}
+
+HttpResponse::~HttpResponse() {}
+
+void HttpResponse::addHeader(const std::string &name, const std::string &value) {
+	_headers.push_back(std::make_pair(name, value));
+}
+
+// Response specific header fields and the blank line ending the head
+std::string HttpResponse::metaData() {
+	std::string headerMetaData = "";
+	for (size_t i = 0; i < _headers.size(); i++)
+		headerMetaData += _headers[i].first + ": " + _headers[i].second + "\r\n";
 	headerMetaData += "\r\n";
 	return headerMetaData;
 }
 
+// The connection stays open unless the client or the server ends it with this response
+std::string HttpResponse::connectionHeader() const {
+	return _keepAlive == true ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+}
+
 std::string HttpResponse::webserverStamp(void) {
-	time_t now = time(0);
-	char buf[100];
-	strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
-	return std::string(buf);
+	return httpDate(time(0));
 }
 
-std::string HttpResponse::buildHttpResponse(const std::string& statusLine, const std::string& contentType, const std::string& body, const clientState& clientData) {
+// Returns the status line and headers, the body is queued separately by respond
+std::string HttpResponse::buildHttpResponse(const std::string& statusLine, const std::string& contentType, const std::string& body) {
 	std::string header;
 	header = "Content-Type: " + contentType + "\r\n";
 	header += "Content-Length: " + std::to_string(body.size()) + "\r\n";
-	header += "Connection: keep-alive\r\n";
+	header += connectionHeader();
 	header += "Date: " + webserverStamp() + "\r\n";
 	header += "Server: Webserv/harsh/oreste/v1.0\r\n";
-	header += metaData(const_cast<clientState &>(clientData));
+	header += metaData();
 
-	return statusLine + header + body;
+	_body = body;
+	return statusLine + header;
 }
 
 std::string HttpResponse::deleteListing(clientState &clientData) {
-	std::string directoryPath = clientData.serverData.root + clientData.requestLine[1];
+	std::string directoryPath = clientData.serverData->root + clientData.path;
 	
 	if (std::filesystem::is_directory(directoryPath) == false) {
 		return genericHttpCodeResponse(404, "Not Found");;
@@ -65,16 +112,16 @@ std::string HttpResponse::deleteListing(clientState &clientData) {
 		const auto &path = entry.path();
 		std::string filename = path.filename().string();
 		std::string icon = entry.is_directory() ? "📁" : "📄";
-		std::string deleteLink = "/delete?file=" + clientData.requestLine[1] + "/" + filename;
+		std::string deleteLink = "/delete?file=" + clientData.path + "/" + filename;
 
 		html << "<tr>\n"
 					<< "    <td>" << icon << "</td>\n"
-					<< "    <td><a href=\"" << clientData.requestLine[1] + "/" + filename << "\">" << filename << "</a></td>\n"
+					<< "    <td><a href=\"" << clientData.path + "/" + filename << "\">" << filename << "</a></td>\n"
 					<< "    <td><button class=\"delete-style\" onclick=\""
 					<< "fetch('" << deleteLink << "', {method: 'DELETE'})"
 					<< ".then(function(response) { "
 					<< "if (response.ok) { "
-					<< "loadDirectoryListing('" << clientData.requestLine[1] << "');"  // Reload the directory listing without closing it
+					<< "loadDirectoryListing('" << clientData.path << "');"  // Reload the directory listing without closing it
 					<< "} else { "
 					<< "alert('Delete failed with status: ' + response.status);"
 					<< "}"
@@ -86,15 +133,15 @@ std::string HttpResponse::deleteListing(clientState &clientData) {
 					<< "</tr>\n";
 		}
 	_status_line = clientData.requestLine[2] + " 200 OK\r\n";
-	_header = "Content-Type: text/html\r\nContent-Length: " + std::to_string(html.str().size()) + "\r\nConnection: keep-alive\r\n";
-	std::string headerMetaData = metaData(clientData);
+	_header = "Content-Type: text/html\r\nContent-Length: " + std::to_string(html.str().size()) + "\r\n" + connectionHeader();
+	std::string headerMetaData = metaData();
 	_header += "Date: " + webserverStamp() + "\r\nServer: Webserv/harsh/oreste/v1.0\r\n" + headerMetaData;
 	_response = _status_line + _header + html.str();
 	return _response;
 }
 
 std::string HttpResponse::directoryListing(clientState &clientData) {
-	std::string directoryPath = clientData.serverData.root + clientData.requestLine[1];
+	std::string directoryPath = clientData.serverData->root + clientData.path;
 	
 	std::ostringstream html;
 	html << "<!DOCTYPE html>\n"
@@ -131,7 +178,7 @@ std::string HttpResponse::directoryListing(clientState &clientData) {
 
 		html << "<tr>\n"
 			 << "	<td>" << icon << "</td>\n"
-			 << "	<td><a href=\"" << clientData.requestLine[1] + "/" + filename << "\">" << filename << "</a></td>\n"
+			 << "	<td><a href=\"" << clientData.path + "/" + filename << "\">" << filename << "</a></td>\n"
 			 << "</tr>\n";
 	}
 
@@ -141,8 +188,8 @@ std::string HttpResponse::directoryListing(clientState &clientData) {
 		 << "</html>\n";
 
 	_status_line = clientData.requestLine[2] + " 200 OK\r\n";
-	_header = "Content-Type: text/html\r\nContent-Length: " + std::to_string(html.str().size()) + "\r\nConnection: keep-alive\r\n";
-	std::string headerMetaData = metaData(clientData);
+	_header = "Content-Type: text/html\r\nContent-Length: " + std::to_string(html.str().size()) + "\r\n" + connectionHeader();
+	std::string headerMetaData = metaData();
 	_header += "Date: " + webserverStamp() + "\r\nServer: Webserv/harsh/oreste/v1.0\r\n" + headerMetaData;
 	_response = _status_line + _header + html.str();
 	return _response;
@@ -150,13 +197,13 @@ std::string HttpResponse::directoryListing(clientState &clientData) {
 
 
 std::string HttpResponse::handleGetFile(clientState &clientData) {
-	static int i = 0;
-	static std::vector<std::string> getImageFiles;
+	thread_local int i = 0;
+	thread_local std::vector<std::string> getImageFiles;
 
 	if (getImageFiles.empty() == true) {
 		for(const auto &entry : std::filesystem::directory_iterator("www/getimage")){
 			const auto &path = entry.path();
-			std::string filename = clientData.serverData.root + "/getimage/" + path.filename().string();
+			std::string filename = clientData.serverData->root + "/getimage/" + path.filename().string();
 			getImageFiles.push_back(filename);
 		}
 	}
@@ -165,198 +212,313 @@ std::string HttpResponse::handleGetFile(clientState &clientData) {
 		i = 0;
 	}
 	
-	std::string route = getImageFiles[i++];
+	return serveFile(clientData, getImageFiles[i++]);
+}
+
+// Small files are answered from the cache. Larger ones only get their header
+// built in memory, the body is queued as a file region the socket layer sends
+// with sendfile so a download costs O(1) memory.
+std::string HttpResponse::serveFile(clientState &clientData, const std::string &route) {
 	size_t pos = route.find_last_of('.');
-	std::string contentType = g_mimeTypes[route.substr(pos + 1)];
-	std::ifstream route_file(route.c_str());
-	if (route_file.fail())
-		return genericHttpCodeResponse(404, httpErrorMap.at(404));
-	else {
-		struct stat statFile;
-		if(stat(route.c_str(), &statFile) != 0) {
-			WARNING("Unable to get file properties");
-			exit(42);
+	std::string contentType = getMimeType(route.substr(pos + 1));
+	std::string path = route;
+	if (isCompressible(contentType) == true) {
+		addHeader("Vary", "Accept-Encoding");
+		std::string encoding = pickEncoding(clientData, route);
+		if (encoding.empty() == false) {
+			path = route + (encoding == "br" ? ".br" : ".gz");
+			addHeader("Content-Encoding", encoding);
 		}
-		std::string buffer((std::istreambuf_iterator<char>(route_file)), std::istreambuf_iterator<char>());
-		_status_line = clientData.requestLine[2] + " 200 OK\r\n";
-
-		_header = "Content-Type: " + contentType + "\r\n"
-							"Content-Length: " + std::to_string(statFile.st_size) + "\r\n"
-							"Connection: keep-alive\r\n";
-		_body = buffer;
-		route_file.close();
 	}
-	std::string headerMetaData = metaData(clientData);
-	_header += "Date: " + webserverStamp() + "\r\nServer: Webserv/harsh/oreste/v1.0\r\n" + headerMetaData;
-	_response = _status_line + _header + _body;
-	return _response;
-}
 
-std::string HttpResponse::responseGet(clientState &clientData) {
+	std::shared_ptr<const FileCache::Entry> cached = _cache.find(path);
+	if (cached && isNotModified(clientData, cached->etag, cached->mtime.tv_sec))
+		return notModified(clientData, cached->validators);
+	if (cached)
+		return serveCached(clientData, *cached);
 
-	std::string route = clientData.serverData.root + (clientData.requestLine[1] == "/" ? "/index.html" : clientData.requestLine[1]);
-	if (clientData.requestLine[1].substr(0, 7) == "/upload" && std::filesystem::is_directory(route)) {
-		if (clientData.serverData.directory_listing == "off")
-			return genericHttpCodeResponse(403, httpErrorMap.at(403));
-		return deleteListing(clientData);
-	}
-	if (clientData.requestLine[1] == "/get-files") {
-		clientData.header["X-File-Type"] = "file";
-		return handleGetFile(clientData);
-	}
-	size_t pos = route.find_last_of('.');
-	std::string contentType = g_mimeTypes[route.substr(pos + 1)];
-	std::ifstream route_file(route.c_str());
-	if (route_file.fail())
+	int fileFd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fileFd == -1)
 		return genericHttpCodeResponse(404, httpErrorMap.at(404));
-
-	if (std::filesystem::is_directory(route) && clientData.serverData.directory_listing == "on") {
-		return directoryListing(clientData); 
-	}
-	clientData.header["X-File-Type"] = "file";
-
 	struct stat statFile;
-	if(stat(route.c_str(), &statFile) != 0) {
+	if (fstat(fileFd, &statFile) != 0) {
 		WARNING("Unable to get file properties");
+		close(fileFd);
 		return genericHttpCodeResponse(500, httpErrorMap.at(500));
 	}
+	if (S_ISREG(statFile.st_mode) == false) {
+		close(fileFd);
+		return genericHttpCodeResponse(403, httpErrorMap.at(403));
+	}
+	std::string etag = entityTag(statFile);
+	std::string validators = "ETag: " + etag + "\r\nLast-Modified: " + httpDate(statFile.st_mtim.tv_sec) + "\r\n";
+	if (isNotModified(clientData, etag, statFile.st_mtim.tv_sec)) {
+		close(fileFd);
+		return notModified(clientData, validators);
+	}
 
-	std::string buffer((std::istreambuf_iterator<char>(route_file)), std::istreambuf_iterator<char>());
-	_status_line = clientData.requestLine[2] + " 200 OK\r\n";
-
-	std::stringstream ss;
-	ss << statFile.st_size;
-	std::string fileSize;
-	ss >> fileSize;
+	cached = _cache.insert(path, fileFd, statFile, contentType);
+	if (cached) {
+		close(fileFd);
+		return serveCached(clientData, *cached);
+	}
 
-	_header = "Content-Type: " + contentType + "\r\nContent-Length: " + fileSize + "\r\nConnection: keep-alive\r\n";
-	_body = buffer;
-	route_file.close();
+	_file = std::make_shared<OpenFile>(fileFd);
+	_fileSize = statFile.st_size;
+	std::string ranged = serveRanges(clientData, contentType, statFile.st_size, etag, statFile.st_mtim.tv_sec, validators);
+	if (ranged.empty() == false)
+		return ranged;
 
-	std::string headerMetaData = metaData(clientData);
+	_status_line = clientData.requestLine[2] + " 200 OK\r\n";
+	_header = "Content-Type: " + contentType + "\r\nContent-Length: " + std::to_string(statFile.st_size) + "\r\nAccept-Ranges: bytes\r\n" + validators + connectionHeader();
+	std::string headerMetaData = metaData();
 	_header += "Date: " + webserverStamp() + "\r\nServer: Webserv/harsh/oreste/v1.0\r\n" + headerMetaData;
-	_response = _status_line + _header + _body;
+	_response = _status_line + _header;
 	return _response;
 }
 
-bool HttpResponse::isValidChar(char c) {
-	return isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/';
+std::string HttpResponse::serveCached(clientState &clientData, const FileCache::Entry &entry) {
+	std::string ranged = serveRanges(clientData, entry.contentType, entry.size, entry.etag, entry.mtime.tv_sec, entry.validators);
+	if (ranged.empty() == false && entry.mapping) {
+		if (_parts.empty() == false)
+			_mapping = entry.mapping;
+		return ranged;
+	}
+	if (ranged.empty() == false) {
+		// Small files, their ranges are copied out of memory
+		for (size_t i = 0; i < _parts.size(); i++)
+			_body += _parts[i].prefix + entry.content->substr(_parts[i].offset, _parts[i].length);
+		_parts.clear();
+		return ranged;
+	}
+	_shared = entry.content;
+	_mapping = entry.mapping;
+	_status_line = clientData.requestLine[2] + " 200 OK\r\n";
+	_header = entry.headers + "Accept-Ranges: bytes\r\n" + entry.validators + connectionHeader();
+	std::string headerMetaData = metaData();
+	_header += "Date: " + webserverStamp() + "\r\nServer: Webserv/harsh/oreste/v1.0\r\n" + headerMetaData;
+	_response = _status_line + _header;
+	return _response;
 }
 
-bool HttpResponse::isValidStr(const std::string &str) {
-	for (size_t i = 0; i < str.length(); ++i) {
-		if (!isValidChar(str[i]))
-			return false;
-	}
-	return true;
+// A precompressed sidecar next to the file the client accepts, best quality
+// first and brotli on a tie; empty to send the file as it is. Nothing is
+// compressed at request time, the sidecars come from make precompress.
+std::string HttpResponse::pickEncoding(const clientState &clientData, const std::string &route) {
+	if (clientData.headers.has(HEADER_ACCEPT_ENCODING) == false)
+		return "";
+	std::string_view accepted = clientData.headers.get(HEADER_ACCEPT_ENCODING);
+	int brotli = codingQuality(accepted, "br");
+	int gzip = codingQuality(accepted, "gzip");
+	if (brotli >= gzip && brotli > 0 && _cache.hasSidecar(route + ".br", route))
+		return "br";
+	if (gzip > 0 && _cache.hasSidecar(route + ".gz", route))
+		return "gzip";
+	if (brotli > 0 && gzip > brotli && _cache.hasSidecar(route + ".br", route))
+		return "br";
+	return "";
 }
 
-bool HttpResponse::writeToFile(clientState &clientData, const std::string& path, const std::string& content) {
-	std::ofstream outFile(path.c_str(), std::ios::binary);
-	if (!outFile){
-		WARNING("Error: Unable to open file for writing: " + path);
-		clientData.flagFileStatus = true;
+// If-None-Match decides when present, If-Modified-Since only without it
+bool HttpResponse::isNotModified(const clientState &clientData, const std::string &etag, time_t modified) {
+	const HeaderTable &headers = clientData.headers;
+	if (headers.has(HEADER_IF_NONE_MATCH)) {
+		std::string_view candidates = headers.get(HEADER_IF_NONE_MATCH);
+		while (candidates.empty() == false) {
+			size_t comma = candidates.find(',');
+			std::string_view tag = trim(candidates.substr(0, comma));
+			// GET compares weakly, a W/ prefix does not matter
+			if (tag.compare(0, 2, "W/") == 0)
+				tag.remove_prefix(2);
+			if (tag == "*" || tag == etag)
+				return true;
+			if (comma == std::string_view::npos)
+				break;
+			candidates.remove_prefix(comma + 1);
+		}
+		return false;
 	}
-	outFile.write(content.c_str(), content.size());
-	outFile.close();
-	if (!outFile){
-		WARNING("Error: Failed to write file: " + path);
-		clientData.flagFileStatus = true;
+	if (headers.has(HEADER_IF_MODIFIED_SINCE)) {
+		time_t since = parseHttpDate(headers.get(HEADER_IF_MODIFIED_SINCE));
+		return since != -1 && modified <= since;
 	}
-	return (clientData.flagFileStatus);
+	return false;
 }
 
-void HttpResponse::parseHeaders(std::istringstream& contentStream, std::string& fileName, std::string& fileContent) {
-	std::string line;
-	bool headerParsed = false;
+// The client's copy is current: validators only, no body and no file I/O
+std::string HttpResponse::notModified(clientState &clientData, const std::string &validators) {
+	_status_line = clientData.requestLine[2] + " 304 Not Modified\r\n";
+	_header = validators + connectionHeader();
+	std::string headerMetaData = metaData();
+	_header += "Date: " + webserverStamp() + "\r\nServer: Webserv/harsh/oreste/v1.0\r\n" + headerMetaData;
+	_response = _status_line + _header;
+	return _response;
+}
 
-	while (std::getline(contentStream, line)) {
-		if (line == "\r" || line.empty()) {
-			headerParsed = true;
-			break;
-		}
-		if (line.find("filename=\"") != std::string::npos) {
-			std::size_t startPos = line.find("filename=\"") + 10;
-			std::size_t endPos = line.find("\"", startPos);
-			if (endPos != std::string::npos) {
-				fileName = line.substr(startPos, endPos - startPos);
-			}
+// Without If-Range every Range applies. With it the range is only sent when
+// the client's copy is still current: a strong ETag match or the exact date.
+bool HttpResponse::rangeApplies(const clientState &clientData, const std::string &etag, time_t modified) {
+	if (clientData.headers.has(HEADER_RANGE) == false)
+		return false;
+	if (clientData.headers.has(HEADER_IF_RANGE) == false)
+		return true;
+	std::string_view condition = clientData.headers.get(HEADER_IF_RANGE);
+	if (condition.empty() == false && condition.front() == '"')
+		return condition == etag;
+	return parseHttpDate(condition) == modified;
+}
+
+// 206 with the satisfiable ranges as inclusive [first, last] pairs, 416 if
+// none is, 200 when the header is malformed or asks for too much and the
+// whole file is sent instead
+int HttpResponse::parseRanges(std::string_view header, off_t size, std::vector<std::pair<off_t, off_t> > &ranges) {
+	ranges.clear();
+	if (header.size() < 6 || HeaderTable::equalsIgnoreCase(header.substr(0, 6), "bytes=") == false)
+		return 200;
+	header.remove_prefix(6);
+	size_t count = 0;
+	while (header.empty() == false) {
+		size_t comma = header.find(',');
+		std::string_view spec = trim(header.substr(0, comma));
+		header.remove_prefix(comma == std::string_view::npos ? header.size() : comma + 1);
+		if (spec.empty() == true)
+			continue;
+		if (++count > maxRanges)
+			return 200;
+		size_t dash = spec.find('-');
+		if (dash == std::string_view::npos)
+			return 200;
+		std::string_view from = spec.substr(0, dash);
+		std::string_view to = spec.substr(dash + 1);
+		off_t first = 0;
+		off_t last = 0;
+		if (from.empty() == false && std::from_chars(from.data(), from.data() + from.size(), first).ptr != from.data() + from.size())
+			return 200;
+		if (to.empty() == false && std::from_chars(to.data(), to.data() + to.size(), last).ptr != to.data() + to.size())
+			return 200;
+		if (from.empty() == true) {
+			// A suffix: the last "to" bytes
+			if (to.empty() == true)
+				return 200;
+			if (last == 0 || size == 0)
+				continue;
+			first = last >= size ? 0 : size - last;
+			last = size - 1;
+		} else {
+			if (to.empty() == false && last < first)
+				return 200;
+			if (first >= size)
+				continue;
+			if (to.empty() == true || last >= size)
+				last = size - 1;
 		}
+		ranges.push_back(std::make_pair(first, last));
 	}
-	if (!headerParsed) {
-		std::cerr << "Error: Incomplete headers, waiting for more data." << std::endl;
-		return;
-	}
-	fileContent.assign((std::istreambuf_iterator<char>(contentStream)), std::istreambuf_iterator<char>());
+	if (count == 0)
+		return 200;
+	return ranges.empty() == true ? 416 : 206;
 }
 
-std::string HttpResponse::findBoundary(const std::map<std::string, std::string>& headers) {
-	std::map<std::string, std::string>::const_iterator contentTypeIt = headers.find("Content-Type");
-	if (contentTypeIt == headers.end())
+// Builds the head of a 206 or 416 and the regions of _file it sends. One
+// range is sent as is, several as multipart/byteranges. Empty when the whole
+// file should be sent.
+std::string HttpResponse::serveRanges(clientState &clientData, const std::string &contentType, off_t size,
+			const std::string &etag, time_t modified, const std::string &validators) {
+	if (rangeApplies(clientData, etag, modified) == false)
 		return "";
-	const std::string& contentType = contentTypeIt->second;
-	std::string::size_type boundaryPos = contentType.find("boundary=");
-	if (boundaryPos == std::string::npos)
+	std::vector<std::pair<off_t, off_t> > ranges;
+	int status = parseRanges(clientData.headers.get(HEADER_RANGE), size, ranges);
+	if (status == 200)
 		return "";
-	boundaryPos += 9;
-	std::string::size_type boundaryEnd = contentType.find(";", boundaryPos);
-	std::string boundary = contentType.substr(boundaryPos, boundaryEnd - boundaryPos);
-	if (!boundary.empty() && boundary.front() == '"' && boundary.back() == '"')
-		boundary = boundary.substr(1, boundary.size() - 2);
-	return boundary;
-}
-
-bool HttpResponse::parseRequestBody(clientState &clientData) {
-	std::string boundary = "--" + clientData.boundary;
-	std::size_t boundaryStart = clientData.bodyString.find(boundary);
-	if (boundaryStart == std::string::npos)
-		return true;
-	std::size_t boundaryEnd = clientData.bodyString.find("\r\n", boundaryStart);
-	if (boundaryEnd == std::string::npos)
-		return true;
-	boundaryEnd += 2;
-	std::size_t nextBoundaryStart = clientData.bodyString.find(boundary, boundaryEnd);
-	if (nextBoundaryStart == std::string::npos)
-		return true;
-	std::string bodyPart = clientData.bodyString.substr(boundaryEnd, nextBoundaryStart - boundaryEnd);
-	std::istringstream contentStream(bodyPart);
-	std::string fileName;
-	std::string fileContent;
-
-	parseHeaders(contentStream, fileName, fileContent);
-	std::string filePath = "./www/upload/" + fileName;
-	clientData.fileName = filePath;
-	if (fileName.empty()) {
-		clientData.flagFileStatus = true;
-		return true;
+
+	std::string total = "/" + std::to_string(size);
+	_parts.clear();
+	if (status == 416) {
+		_file.reset();
+		_status_line = clientData.requestLine[2] + " 416 Range Not Satisfiable\r\n";
+		_header = "Content-Range: bytes *" + total + "\r\nContent-Length: 0\r\n";
+	} else if (ranges.size() == 1) {
+		off_t first = ranges[0].first;
+		off_t length = ranges[0].second - first + 1;
+		_parts.push_back(BodyPart{"", first, length});
+		_status_line = clientData.requestLine[2] + " 206 Partial Content\r\n";
+		_header = "Content-Type: " + contentType + "\r\nContent-Range: bytes " + std::to_string(first) + "-"
+			+ std::to_string(ranges[0].second) + total + "\r\nContent-Length: " + std::to_string(length) + "\r\n";
+	} else {
+		thread_local std::mt19937_64 random(std::random_device{}());
+		char boundary[17];
+		snprintf(boundary, sizeof(boundary), "%016llx", static_cast<unsigned long long>(random()));
+		off_t length = 0;
+		for (size_t i = 0; i < ranges.size(); i++) {
+			std::string prefix = "\r\n--" + std::string(boundary) + "\r\nContent-Type: " + contentType
+				+ "\r\nContent-Range: bytes " + std::to_string(ranges[i].first) + "-" + std::to_string(ranges[i].second)
+				+ total + "\r\n\r\n";
+			off_t regionLength = ranges[i].second - ranges[i].first + 1;
+			length += prefix.size() + regionLength;
+			_parts.push_back(BodyPart{prefix, ranges[i].first, regionLength});
+		}
+		std::string closing = "\r\n--" + std::string(boundary) + "--\r\n";
+		length += closing.size();
+		_parts.push_back(BodyPart{closing, 0, 0});
+		_status_line = clientData.requestLine[2] + " 206 Partial Content\r\n";
+		_header = "Content-Type: multipart/byteranges; boundary=" + std::string(boundary)
+			+ "\r\nContent-Length: " + std::to_string(length) + "\r\n";
 	}
-	if (access(clientData.fileName.c_str(), F_OK) == 0)
-		return false;
-	writeToFile(clientData, filePath, fileContent);
-	clientData.bodyString.erase(0, nextBoundaryStart);
-	clientData.flagBodyRead = true;
-	return true;
+	_header += "Accept-Ranges: bytes\r\n" + validators + connectionHeader();
+	std::string headerMetaData = metaData();
+	_header += "Date: " + webserverStamp() + "\r\nServer: Webserv/harsh/oreste/v1.0\r\n" + headerMetaData;
+	_response = _status_line + _header;
+	return _response;
+}
+
+std::string HttpResponse::responseGet(clientState &clientData) {
+
+	std::string route = clientData.serverData->root + (clientData.path == "/" ? "/index.html" : clientData.path);
+	if (clientData.path.substr(0, 7) == "/upload" && std::filesystem::is_directory(route)) {
+		if (clientData.serverData->directory_listing == "off")
+			return genericHttpCodeResponse(403, httpErrorMap.at(403));
+		return deleteListing(clientData);
+	}
+	if (clientData.path == "/get-files") {
+		addHeader("X-File-Type", "file");
+		return handleGetFile(clientData);
+	}
+	if (std::filesystem::is_directory(route) && clientData.serverData->directory_listing == "on") {
+		return directoryListing(clientData); 
+	}
+	addHeader("X-File-Type", "file");
+	return serveFile(clientData, route);
+}
+
+bool HttpResponse::isValidChar(char c) {
+	return isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/';
+}
+
+// Same character class as isValidChar, checked 16 or 32 bytes at a time
+bool HttpResponse::isValidStr(const std::string &str) {
+	return Scanner::isUrlSafe(str);
 }
 
 std::string HttpResponse::responsePost(clientState &clientData) {
-	std::string route = "./www" + clientData.requestLine[1];
-	if (!isValidStr(route) || clientData.bodyString.empty())
+	std::string route = "./www" + clientData.path;
+	if (!isValidStr(route) || clientData.bodySize == 0)
 		return genericHttpCodeResponse(400, httpErrorMap.at(400));
 
-	size_t pos = route.find_last_of('.');
-	std::string contentType = g_mimeTypes[route.substr(pos + 1)];
-
-	clientData.boundary = findBoundary(clientData.header);
-	if (!parseRequestBody(clientData)) {
-		std::ifstream file(clientData.fileName.c_str());
+	// The parts were written while the body arrived, only the outcome is left
+	MultipartUpload &upload = clientData.upload;
+	if (upload.finished() == false) {
+		upload.abort();
+		return genericHttpCodeResponse(400, httpErrorMap.at(400));
+	}
+	if (upload.firstExisted() == true) {
+		std::ifstream file(upload.firstFile().c_str());
 		std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-		size_t pos = clientData.fileName.find_last_of('.');
-		std::string contentType = g_mimeTypes[clientData.fileName.substr(pos + 1)];
+		size_t pos = upload.firstFile().find_last_of('.');
+		std::string contentType = getMimeType(upload.firstFile().substr(pos + 1));
 		_status_line = clientData.requestLine[2] + " 302 Found\r\n";
-		return buildHttpResponse(_status_line, contentType, buffer, clientData);
+		return buildHttpResponse(_status_line, contentType, buffer);
 	}
-	clientData.bodyString.clear();
-	if (clientData.flagFileStatus == true)
+	if (upload.saved() == 0)
 		return genericHttpCodeResponse(400, httpErrorMap.at(400));
 	return genericHttpCodeResponse(201, httpErrorMap.at(201));
 }
@@ -433,34 +595,21 @@ std::string HttpResponse::genericHttpCodeResponse(int statusCode, const std::str
 	response << "\r\n";
 	response << "Content-Type: text/html\r\n";
 	response << "Content-Length: " << msg.length() << "\r\n";
+	response << connectionHeader();
 	response << "\r\n";
 
 	response << msg;
 	return response.str();
 }
 
-std::string urlDecode(const std::string& value) {
-    std::string decoded;
-		decoded.reserve(value.size());
-
-		for(size_t i = 0; i < value.size(); i++) {
-			if (value[i] == '%') {
-				if (i + 2 < value.size() && value[i + 1] == '2' && value[i + 2] == '0') {
-					decoded += ' ';
-					i += 2;
-				} else {
-					decoded += value[i];
-				}
-			} else {
-				decoded += value[i];
-			}
-		}
-	return decoded;
-}
-
 std::string HttpResponse::responseDelete(clientState &clientData) {
-	std::string filename = urlDecode(clientData.requestLine[1].substr(clientData.requestLine[1].find("=") + 1));
-	const std::string& filePath = clientData.serverData.root + filename;
+	// The file to delete comes as a form encoded path in the query
+	std::string decoded;
+	std::string filename;
+	if (UrlPath::decode(UrlPath::param(clientData.query, "file"), decoded, true) == false
+		|| UrlPath::normalize("/" + decoded, filename) == false)
+		return genericHttpCodeResponse(400, httpErrorMap.at(400));
+	const std::string& filePath = clientData.serverData->root + filename;
 
 	FILE* file = std::fopen(filePath.c_str(), "r");
 	if (!file)
@@ -473,15 +622,16 @@ std::string HttpResponse::responseDelete(clientState &clientData) {
 }
 
 std::string HttpResponse::responseRedirect(clientState &clientData) {
-	for (auto &location : clientData.serverData.location) {
+	for (auto &location : clientData.serverData->location) {
 		if (!location.redirect.empty()) {
 			if (location.redirect.substr(0, 7) != "http://" && location.redirect.substr(0, 8) != "https://") {
-				clientData.header["Location"] = "https://" + location.redirect;
+				addHeader("Location", "https://" + location.redirect);
 			} else {
-				clientData.header["Location"] = location.redirect;
+				addHeader("Location", location.redirect);
 			}
 			_status_line = clientData.requestLine[2] + " 302 Found\r\n";
-			std::string headerMetaData = metaData(clientData);
+			_header = "Content-Length: 0\r\n";
+			std::string headerMetaData = metaData();
 			_header += "Date: " + webserverStamp() + "\r\nServer: Webserv/harsh/oreste/v1.0\r\n" + headerMetaData;
 			_response = _status_line + _header;
 
@@ -505,10 +655,13 @@ std::string HttpResponse::processCgi(clientState &clientData) {
 	if (clientData.isForked == true)
 		return parentProcess(clientData);
 	INFO("CGI start on socket: " << clientData.socketFd);
-	if (pipe(clientData.fd) == -1) {
+	// Close on exec, so a CGI forked by another worker thread does not keep
+	// this pipe open; dup2 onto stdout clears the flag for our own script
+	if (pipe2(clientData.fd, O_CLOEXEC) == -1) {
 		ERROR("Pipe failed");
 		return genericHttpCodeResponse(500, httpErrorMap.at(500));
 	}
+	fcntl(clientData.fd[0], F_SETFL, O_NONBLOCK);
 	clientData.pid = fork();
 	if (clientData.pid == -1) {
 		ERROR("Fork Failed");
@@ -524,26 +677,30 @@ std::string HttpResponse::processCgi(clientState &clientData) {
 		dup2(clientData.fd[1], STDOUT_FILENO);
 		close(clientData.fd[1]);
 		execute(clientData);
-		exit(42);
+		_exit(42);
 	} else {
 		close(clientData.fd[1]);
 		return parentProcess(clientData);
 	}
 }
 
+// Reads what the script wrote so far without blocking, so a full pipe never
+// stalls the script and a slow script never stalls the event loop
+static void drainCgiOutput(clientState &clientData) {
+	char buffer[4096];
+	ssize_t count;
+	while ((count = read(clientData.fd[0], buffer, sizeof(buffer))) > 0)
+		clientData.cgiOutput.append(buffer, count);
+}
+
 std::string HttpResponse::parentProcess(clientState &clientData) {
 	std::string result;
-	std::vector<char> buffer(4096);
-	
 	int status;
-	ssize_t count;
 
+	drainCgiOutput(clientData);
 	pid_t resultPid = waitpid(clientData.pid, &status, WNOHANG);
 	if (resultPid == 0) {
-		time_t currentTime = 0;
-
-		std::time(&currentTime);
-		if (std::difftime(currentTime, clientData.lastEventTime) > clientData.serverData.send_timeout) {
+		if (TimerQueue::now() >= clientData.deadline) {
 			ERROR("CGI script timed out on socket: " << clientData.socketFd);
 			kill(clientData.pid, SIGKILL);
 			close(clientData.fd[0]);
@@ -561,10 +718,8 @@ std::string HttpResponse::parentProcess(clientState &clientData) {
 	if (WIFEXITED(status)) {
 		int exitStatus = WEXITSTATUS(status);
 		if (exitStatus == 0) {
-			while ((count = read(clientData.fd[0], buffer.data(), buffer.size())) > 0) {
-				result.append(buffer.data(), count);
-			}
-			
+			drainCgiOutput(clientData);
+			result.swap(clientData.cgiOutput);
 			close(clientData.fd[0]);
 			clientData.isForked = false;
 			
@@ -572,7 +727,7 @@ std::string HttpResponse::parentProcess(clientState &clientData) {
 				return genericHttpCodeResponse(502, httpErrorMap.at(502));
 			}
 			_status_line = clientData.requestLine[2] + " 200 OK\r\n";
-			return buildHttpResponse(_status_line, "text/html", result, clientData);
+			return buildHttpResponse(_status_line, "text/html", result);
 		} else {
 			ERROR("CGI Script exited with error status: " + std::to_string(exitStatus) + " on socket: " << clientData.socketFd);
 			close(clientData.fd[0]);
@@ -591,26 +746,29 @@ void	HttpResponse::execute(clientState &clientData) {
 	std::string scriptname;
 	std::string query;
 	
-	scriptname = clientData.serverData.root + clientData.requestLine[1];
-	if (clientData.method == POST) {
-		query = clientData.bodyString;
-	} else if (clientData.method == GET) {
-		size_t pos = clientData.requestLine[1].find('?');
-		if (pos != std::string::npos) {
-			scriptname = clientData.serverData.root + clientData.requestLine[1].substr(0, pos);
-			query = clientData.requestLine[1].substr(pos + 1);
-		}
+	scriptname = clientData.serverData->root + clientData.path;
+	query = clientData.query;
+
+	// The spooled request body is the script's stdin
+	int input = -1;
+	if (clientData.bodyFile) {
+		input = clientData.bodyFile->fd;
+		lseek(input, 0, SEEK_SET);
+	} else {
+		input = open("/dev/null", O_RDONLY);
 	}
+	if (input != -1)
+		dup2(input, STDIN_FILENO);
 
 	if (checkSuffix(scriptname, ".py") == true) {
 		std::vector<std::string> env_strings = {
 		"QUERY_STRING=" + query,
 			"REQUEST_METHOD=" + clientData.requestLine[0],
-			"CONTENT_LENGTH=" + std::to_string(clientData.contentLength),
+			"CONTENT_LENGTH=" + std::to_string(clientData.bodySize),
 			"GATEWAY_INTERFACE=CGI/1.1",
 			"SCRIPT_NAME=" + scriptname,
-			"SERVER_NAME=" + clientData.serverData.server_name,
-			"SERVER_PORT=" + std::to_string(clientData.serverData.listen),
+			"SERVER_NAME=" + clientData.serverData->server_name,
+			"SERVER_PORT=" + std::to_string(clientData.serverData->listen),
 			"SERVER_PROTOCOL=HTTP/1.1"
 		};
 
@@ -639,16 +797,16 @@ void	HttpResponse::execute(clientState &clientData) {
 	ERROR("execve failed");
 }
 
-bool isMethodsAllowed(clientState &clientData) {
-	std::vector<Location> locations = clientData.serverData.location;
+bool isMethodsAllowed(const clientState &clientData) {
+	const std::vector<Location> &locations = clientData.serverData->location;
 	std::string path;
-	size_t slashPos = clientData.requestLine[1].find_first_of("/", 1);
+	size_t slashPos = clientData.path.find_first_of("/", 1);
 	if (slashPos != std::string::npos)
-		path = clientData.requestLine[1].substr(0, slashPos);
+		path = clientData.path.substr(0, slashPos);
 	else
-		path = clientData.requestLine[1];
+		path = clientData.path;
 
-	for (auto &loc : clientData.serverData.location) {
+	for (auto &loc : clientData.serverData->location) {
 		if (loc.path == path) {
 			for (auto &method : loc.methods) {
 				if (method == clientData.requestLine[0])
@@ -680,21 +838,61 @@ bool isMethodsAllowed(clientState &clientData) {
 	return false;
 }
 
-std::string HttpResponse::respond(clientState &clientData) {
+// Queues the response on the connection: the head, then the body in memory
+// or on disk. Nothing is queued while a CGI is still running.
+void HttpResponse::respond(clientState &clientData) {
+	_body.clear();
+	_headers.clear();
+	_file.reset();
+	_fileSize = 0;
+	_shared.reset();
+	_mapping.reset();
+	_parts.clear();
+	_keepAlive = clientData.isKeepAlive == true && clientData.lastRequest == false;
+
+	std::string head = dispatch(clientData);
+	if (head.empty() == true)
+		return;
+	clientData.output.append(std::move(head));
+	clientData.output.append(std::move(_body));
+	if (_shared)
+		clientData.output.appendShared(_shared);
+	if (_file && _parts.empty())
+		clientData.output.appendFile(_file, 0, _fileSize);
+	if (_mapping && _parts.empty())
+		clientData.output.appendMapped(_mapping, 0, _mapping->size);
+	for (size_t i = 0; i < _parts.size(); i++) {
+		if (_parts[i].prefix.empty() == false)
+			clientData.output.append(std::move(_parts[i].prefix));
+		if (_file && _parts[i].length > 0)
+			clientData.output.appendFile(_file, _parts[i].offset, _parts[i].length);
+		if (_mapping && _parts[i].length > 0)
+			clientData.output.appendMapped(_mapping, _parts[i].offset, _parts[i].length);
+	}
+	_parts.clear();
+	_body.clear();
+	_file.reset();
+	_shared.reset();
+	_mapping.reset();
+}
+
+std::string HttpResponse::dispatch(clientState &clientData) {
+	if (clientData.requestError != 0)
+		return genericHttpCodeResponse(clientData.requestError, httpErrorMap.at(clientData.requestError));
+	if (clientData.flagFileSizeTooBig)
+		return (genericHttpCodeResponse(413, httpErrorMap.at(413)));
 	if (isMethodsAllowed(clientData) == false)
 		return genericHttpCodeResponse(405, httpErrorMap.at(405));
 
-	if (clientData.requestLine[1] == "/redirect") {
+	if (clientData.path == "/redirect") {
 		return responseRedirect(clientData);
-	} else if (clientData.requestLine[1].substr(0, 4) == "/cgi") {
-		if (std::filesystem::is_directory(clientData.serverData.root + clientData.requestLine[1]))
+	} else if (clientData.path.substr(0, 4) == "/cgi") {
+		if (std::filesystem::is_directory(clientData.serverData->root + clientData.path))
 			return directoryListing(clientData);
 		return processCgi(clientData);
 	} else if (clientData.requestLine[0] == "GET") {
 		return responseGet(clientData);
 	} else if (clientData.requestLine[0] == "POST") {
-		if (clientData.flagFileSizeTooBig)
-			return (genericHttpCodeResponse(413, httpErrorMap.at(413)));
 		return responsePost(clientData);
 	} else if (clientData.requestLine[0] == "DELETE") {
 		return responseDelete(clientData);
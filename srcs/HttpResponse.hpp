@@ -16,9 +16,14 @@
 #include <unistd.h>
 #include <vector>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <chrono>
 #include <thread>
+#include "Scanner.hpp"
+#include "TimerQueue.hpp"
 #include "Utils.hpp"
+#include "UrlPath.hpp"
+#include "FileCache.hpp"
 #include <filesystem>
 #include <sys/wait.h>
 
@@ -34,6 +39,19 @@ class HttpResponse {
 		std::string _header;
 		std::string _body;
 		std::string _response;
+		std::shared_ptr<OpenFile> _file; // body sent from disk after _body
+		off_t _fileSize;
+		std::shared_ptr<const std::string> _shared; // cached body, not copied
+		std::shared_ptr<const MappedFile> _mapping; // mapped body, not copied
+		struct BodyPart {
+			std::string prefix; // multipart framing queued before the region
+			off_t offset;
+			off_t length;
+		};
+		std::vector<BodyPart> _parts; // regions of _file or _mapping a range answer sends
+		FileCache &_cache; // the event loop's static file cache
+		std::vector<std::pair<std::string, std::string> > _headers; // response only
+		bool _keepAlive; // set per response by respond
 
 		const std::map<int, std::string> httpErrorMap
 		{
@@ -47,6 +65,9 @@ class HttpResponse {
 			{404,"Page Not Found"},
 			{405,"Method Not Allowed Error"},
 			{413,"Payload Too Large"},
+			{416,"Range Not Satisfiable"},
+			{417,"Expectation Failed"},
+			{431,"Request Header Fields Too Large"},
 			{500,"Internal Server Error"},
 			{501,"Not Implemented"},
 			{502,"Bad Gateway"},
@@ -54,18 +75,30 @@ class HttpResponse {
 		};
 
 	public:
-		HttpResponse();
+		explicit HttpResponse(FileCache &cache);
 		~HttpResponse();
 
-		std::string	metaData(clientState &clientData);
+		void		addHeader(const std::string &name, const std::string &value);
+		std::string	metaData();
 		std::string	webserverStamp(void);
+		std::string	connectionHeader() const;
 
 		std::string generateErrorPage(int code, const std::string& message);
-		std::string respond(clientState &clientData);
+		void respond(clientState &clientData);
+		std::string dispatch(clientState &clientData);
 
 		std::string deleteListing(clientState &clientData);
 		std::string directoryListing(clientState &clientData);
 		std::string handleGetFile(clientState &clientData);
+		std::string serveFile(clientState &clientData, const std::string &route);
+		std::string serveCached(clientState &clientData, const FileCache::Entry &entry);
+		std::string pickEncoding(const clientState &clientData, const std::string &route);
+		bool isNotModified(const clientState &clientData, const std::string &etag, time_t modified);
+		std::string notModified(clientState &clientData, const std::string &validators);
+		bool rangeApplies(const clientState &clientData, const std::string &etag, time_t modified);
+		int parseRanges(std::string_view header, off_t size, std::vector<std::pair<off_t, off_t> > &ranges);
+		std::string serveRanges(clientState &clientData, const std::string &contentType, off_t size,
+					const std::string &etag, time_t modified, const std::string &validators);
 
 		std::string responseGet(clientState &clientData);
 		std::string responsePost(clientState &clientData);
@@ -77,17 +110,15 @@ class HttpResponse {
 		std::string parentProcess(clientState &clientData); 
 
 		std::string buildHttpResponse(const std::string& statusLine, const std::string& contentType,
-					const std::string& body, const clientState& clientData);
+					const std::string& body);
 
 		bool isValidStr(const std::string &str);
 		bool isValidChar(char c);
 		bool checkSuffix(const std::string &str, const std::string &suffix);
 
-		bool 		writeToFile(clientState &clientData, const std::string& path, const std::string& content);
-		void		parseHeaders(std::istringstream& contentStream, std::string& fileName, std::string& fileContent);
-		std::string	findBoundary(const std::map<std::string, std::string>& headers);
-		bool		parseRequestBody(clientState &clientData);
 		std::string	genericHttpCodeResponse(int statusCode, const std::string& message);
 };
 
+bool isMethodsAllowed(const clientState &clientData);
+
 #endif
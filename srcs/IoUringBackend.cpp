@@ -0,0 +1,690 @@
+#ifdef WEBSERV_IO_URING
+
+#include "IoUringBackend.hpp"
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const unsigned ringEntries = 4096;
+// Receive buffers provided to the kernel, shared by every connection
+static const unsigned bufferCount = 1024;
+static const unsigned bufferSize = 8192;
+static const unsigned short bufferGroup = 0;
+// A connection holding this many unread buffers stops receiving until they
+// are read, so one client cannot empty the ring for everybody else
+static const size_t maxHeldBuffers = 16;
+static const int maxIovecs = 64;
+// A send completes once all of it is queued on the socket; bounded so a
+// slow reader still shows progress to the send timeout
+static const size_t maxSendBytes = 256 * 1024;
+
+enum Kind { KIND_IGNORE, KIND_POLL, KIND_ACCEPT, KIND_RECV, KIND_SEND };
+
+// user_data carries the kind of request, the fd and the generation of the
+// fd's requests, so completions for a socket that was closed, and whose
+// number may already be reused, can be told apart
+static unsigned long long makeTag(Kind kind, int fd, unsigned generation) {
+  return (static_cast<unsigned long long>(kind) << 56) |
+         (static_cast<unsigned long long>(generation & 0xffffff) << 32) |
+         static_cast<unsigned>(fd);
+}
+
+IoUringBackend::Watch::Watch()
+    : generation(0), interest(-1), role(ROLE_NONE), revents(0),
+      reported(false), armed(false), cancelled(false), starved(false),
+      polling(false), sending(false), sent(false), closing(false), eof(false),
+      error(0), result(0), length(0), inputOffset(0) {
+  memset(&message, 0, sizeof(message));
+}
+
+IoUringBackend::IoUringBackend()
+    : ringFd(-1), sqRing(MAP_FAILED), cqRing(MAP_FAILED), sqes(NULL),
+      bufferRing(NULL), bufferMemory(NULL), bufferTail(0),
+      heldBuffers(bufferCount) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = ringEntries * 4;
+
+  ringFd = syscall(__NR_io_uring_setup, ringEntries, &params);
+  if (ringFd < 0)
+    throw std::runtime_error("Failed to create io_uring instance: " +
+                             std::string(strerror(errno)));
+  if (!(params.features & IORING_FEAT_EXT_ARG)) {
+    release();
+    throw std::runtime_error("io_uring needs Linux 6.0 or newer");
+  }
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (cqRingSize > sqRingSize)
+      sqRingSize = cqRingSize;
+    cqRingSize = sqRingSize;
+  }
+  sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    cqRing = sqRing;
+  else if (sqRing != MAP_FAILED)
+    cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+  sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqeMap = MAP_FAILED;
+  if (sqRing != MAP_FAILED && cqRing != MAP_FAILED)
+    sqeMap = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+  if (sqeMap == MAP_FAILED) {
+    int error = errno;
+    release();
+    throw std::runtime_error("Failed to map io_uring rings: " +
+                             std::string(strerror(error)));
+  }
+  sqes = static_cast<struct io_uring_sqe *>(sqeMap);
+
+  char *sq = static_cast<char *>(sqRing);
+  sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(cqRing);
+  cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+
+  // Buffer ring the kernel picks receive buffers from
+  void *ring = mmap(NULL, bufferCount * sizeof(struct io_uring_buf),
+                    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  void *memory = mmap(NULL, bufferCount * bufferSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring != MAP_FAILED)
+    bufferRing = static_cast<struct io_uring_buf_ring *>(ring);
+  if (memory != MAP_FAILED)
+    bufferMemory = static_cast<char *>(memory);
+  struct io_uring_buf_reg registration;
+  memset(&registration, 0, sizeof(registration));
+  registration.ring_addr = reinterpret_cast<unsigned long long>(ring);
+  registration.ring_entries = bufferCount;
+  registration.bgid = bufferGroup;
+  if (bufferRing == NULL || bufferMemory == NULL ||
+      syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING,
+              &registration, 1) < 0) {
+    int error = errno;
+    release();
+    throw std::runtime_error("Failed to register io_uring buffers (Linux "
+                             "6.0 or newer is needed): " +
+                             std::string(strerror(error)));
+  }
+  for (unsigned id = 0; id < bufferCount; id++)
+    provideBuffer(id);
+}
+
+IoUringBackend::~IoUringBackend() { release(); }
+
+void IoUringBackend::release() {
+  if (bufferMemory != NULL)
+    munmap(bufferMemory, bufferCount * bufferSize);
+  if (bufferRing != NULL)
+    munmap(bufferRing, bufferCount * sizeof(struct io_uring_buf));
+  if (sqes != NULL)
+    munmap(sqes, sqesSize);
+  if (cqRing != MAP_FAILED && cqRing != sqRing)
+    munmap(cqRing, cqRingSize);
+  if (sqRing != MAP_FAILED)
+    munmap(sqRing, sqRingSize);
+  if (ringFd != -1)
+    ::close(ringFd);
+}
+
+int IoUringBackend::enter(unsigned toSubmit, unsigned minComplete,
+                          unsigned flags, void *arg, size_t argSize) {
+  return syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags,
+                 arg, argSize);
+}
+
+// SQEs written but not consumed by the kernel yet
+unsigned IoUringBackend::queued() const {
+  return *sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+}
+
+// Submits early when fewer than count SQEs are free, so a linked chain is
+// never split across two submissions
+void IoUringBackend::makeRoom(unsigned count) {
+  if (queued() + count > *sqMask + 1 && enter(queued(), 0, 0, NULL, 0) < 0)
+    throw std::runtime_error("io_uring submit failed: " +
+                             std::string(strerror(errno)));
+}
+
+// The kernel copies SQEs on submit
+struct io_uring_sqe *IoUringBackend::nextSqe() {
+  makeRoom(1);
+  unsigned tail = *sqTail;
+  unsigned index = tail & *sqMask;
+  struct io_uring_sqe *sqe = &sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqArray[index] = index;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+  return sqe;
+}
+
+IoUringBackend::Watch &IoUringBackend::watch(int fd) {
+  if (static_cast<size_t>(fd) >= watches.size())
+    watches.resize(fd + 1);
+  return watches[fd];
+}
+
+// Forgets the fd's state; completions still in flight carry the old
+// generation. reported stays, the fd may still sit in pending.
+void IoUringBackend::reset(Watch &watch) {
+  for (size_t i = 0; i < watch.input.size(); i++)
+    provideBuffer(watch.input[i].id);
+  watch.input.clear();
+  watch.accepted.clear();
+  watch.generation++;
+  watch.interest = -1;
+  watch.role = ROLE_NONE;
+  watch.revents = 0;
+  watch.armed = false;
+  watch.cancelled = false;
+  watch.starved = false;
+  watch.polling = false;
+  watch.sending = false;
+  watch.sent = false;
+  watch.closing = false;
+  watch.eof = false;
+  watch.error = 0;
+  watch.inputOffset = 0;
+}
+
+void IoUringBackend::markPending(int fd) {
+  Watch &watch = watches[fd];
+  if (watch.reported == true)
+    return;
+  watch.reported = true;
+  pending.push_back(fd);
+}
+
+short IoUringBackend::readiness(Watch &watch) {
+  short revents = watch.revents;
+  watch.revents = 0;
+  if (watch.role == ROLE_LISTENER && (!watch.accepted.empty() || watch.error))
+    revents |= POLLIN;
+  if (watch.role != ROLE_CONNECTION)
+    return revents;
+  if ((watch.interest & POLLIN) &&
+      (!watch.input.empty() || watch.eof || watch.error))
+    revents |= POLLIN;
+  if ((watch.interest & POLLOUT) &&
+      (watch.sent || (!watch.sending && !watch.polling)))
+    revents |= POLLOUT;
+  return revents;
+}
+
+// Requests
+
+void IoUringBackend::pollAdd(int fd, short events, bool multishot) {
+  Watch &watch = this->watch(fd);
+  struct io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+  sqe->poll32_events = static_cast<unsigned short>(events);
+  sqe->user_data = makeTag(KIND_POLL, fd, watch.generation);
+}
+
+void IoUringBackend::pollRemove(int fd) {
+  struct io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = makeTag(KIND_POLL, fd, watches[fd].generation);
+  sqe->user_data = makeTag(KIND_IGNORE, fd, 0);
+  watches[fd].generation++;
+}
+
+void IoUringBackend::armAccept(int fd) {
+  struct io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  sqe->user_data = makeTag(KIND_ACCEPT, fd, watches[fd].generation);
+  watches[fd].armed = true;
+}
+
+void IoUringBackend::armRecv(int fd) {
+  struct io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = bufferGroup;
+  sqe->user_data = makeTag(KIND_RECV, fd, watches[fd].generation);
+  watches[fd].armed = true;
+  watches[fd].cancelled = false;
+}
+
+// Receives again once the old request ended, and buffers are left for it.
+// Never behind a linked close, the fd may already belong to someone else.
+void IoUringBackend::resumeRecv(int fd) {
+  Watch &watch = watches[fd];
+  if (watch.armed || watch.closing || watch.eof || watch.error ||
+      watch.input.size() >= maxHeldBuffers)
+    return;
+  if (heldBuffers < bufferCount)
+    armRecv(fd);
+  else if (watch.starved == false) {
+    watch.starved = true;
+    starved.push_back(fd);
+  }
+}
+
+void IoUringBackend::cancel(unsigned long long tag) {
+  struct io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = tag;
+  sqe->user_data = makeTag(KIND_IGNORE, 0, 0);
+}
+
+// A live recv keeps the socket open after its fd is closed, so every
+// request on it is cancelled first; the close runs whatever that returns
+void IoUringBackend::closeSocket(int fd) {
+  makeRoom(2);
+  struct io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = fd;
+  sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+  sqe->flags = IOSQE_IO_HARDLINK;
+  sqe->user_data = makeTag(KIND_IGNORE, fd, 0);
+  sqe = nextSqe();
+  sqe->opcode = IORING_OP_CLOSE;
+  sqe->fd = fd;
+  sqe->user_data = makeTag(KIND_IGNORE, fd, 0);
+}
+
+// Entries are indexed by hand: in C++ the uapi flexible array bufs lands
+// 8 bytes into the ring instead of overlaying the tail
+void IoUringBackend::provideBuffer(unsigned short id) {
+  struct io_uring_buf &buffer = reinterpret_cast<struct io_uring_buf *>(
+      bufferRing)[bufferTail & (bufferCount - 1)];
+  buffer.addr = reinterpret_cast<unsigned long long>(
+      bufferMemory + static_cast<size_t>(id) * bufferSize);
+  buffer.len = bufferSize;
+  buffer.bid = id;
+  bufferTail++;
+  __atomic_store_n(&bufferRing->tail, bufferTail, __ATOMIC_RELEASE);
+  heldBuffers--;
+}
+
+// Registration
+
+void IoUringBackend::add(int fd, short events) {
+  Watch &watch = this->watch(fd);
+  watch.role = ROLE_POLL;
+  watch.interest = events;
+  watch.armed = true;
+  pollAdd(fd, events, true);
+}
+
+// A new poll request reports readiness that is already there, like
+// EPOLL_CTL_MOD re-arming an edge. Connections only change what is
+// reported, their requests do not depend on interest.
+void IoUringBackend::modify(int fd, short events) {
+  Watch &watch = watches[fd];
+  if (watch.role == ROLE_CONNECTION) {
+    watch.interest = events;
+    markPending(fd);
+    return;
+  }
+  pollRemove(fd);
+  watch.interest = events;
+  pollAdd(fd, events, true);
+}
+
+void IoUringBackend::remove(int fd) {
+  if (static_cast<size_t>(fd) >= watches.size() || watches[fd].interest == -1)
+    return;
+  if (watches[fd].role == ROLE_POLL)
+    pollRemove(fd);
+  else
+    cancel(makeTag(watches[fd].role == ROLE_LISTENER ? KIND_ACCEPT : KIND_RECV,
+                   fd, watches[fd].generation));
+  reset(watches[fd]);
+}
+
+// Several rings waiting on one listener each get their own connections
+void IoUringBackend::addShared(int fd) { addListener(fd); }
+
+void IoUringBackend::addListener(int fd) {
+  Watch &watch = this->watch(fd);
+  watch.role = ROLE_LISTENER;
+  watch.interest = POLLIN;
+  listeners.push_back(fd);
+  armAccept(fd);
+}
+
+void IoUringBackend::addConnection(int fd) {
+  Watch &watch = this->watch(fd);
+  watch.role = ROLE_CONNECTION;
+  watch.interest = POLLIN;
+  armRecv(fd);
+}
+
+// Socket I/O
+
+// A socket whose close was linked behind its last send may be closed by the
+// kernel, and its number accepted again, before SocketManager let go of it.
+// Such a connection waits in the queue until the old one is gone.
+int IoUringBackend::accept(int listenFd) {
+  Watch &listener = watches[listenFd];
+  std::deque<int>::iterator it;
+  for (it = listener.accepted.begin(); it != listener.accepted.end(); it++) {
+    int fd = *it;
+    if (static_cast<size_t>(fd) < watches.size() &&
+        watches[fd].interest != -1)
+      continue;
+    listener.accepted.erase(it);
+    return fd;
+  }
+  if (listener.error != 0) {
+    errno = listener.error;
+    listener.error = 0;
+    return -1;
+  }
+  if (listener.armed == false)
+    armAccept(listenFd);
+  errno = EAGAIN;
+  return -1;
+}
+
+ssize_t IoUringBackend::receive(int fd, char *buffer, size_t length) {
+  Watch &watch = watches[fd];
+  size_t copied = 0;
+  while (copied < length && watch.input.empty() == false) {
+    Chunk &chunk = watch.input.front();
+    size_t count = std::min(static_cast<size_t>(chunk.length) -
+                                watch.inputOffset,
+                            length - copied);
+    memcpy(buffer + copied,
+           bufferMemory + static_cast<size_t>(chunk.id) * bufferSize +
+               watch.inputOffset,
+           count);
+    copied += count;
+    watch.inputOffset += count;
+    if (watch.inputOffset == chunk.length) {
+      provideBuffer(chunk.id);
+      watch.input.pop_front();
+      watch.inputOffset = 0;
+    }
+  }
+  resumeRecv(fd);
+  // Input left over when the caller stops reading is reported again
+  if (watch.input.empty() == false)
+    markPending(fd);
+  if (copied > 0)
+    return copied;
+  if (watch.eof == true)
+    return 0;
+  if (watch.error != 0) {
+    errno = watch.error;
+    return -1;
+  }
+  errno = EAGAIN;
+  return -1;
+}
+
+// The result of the send in flight comes back through the next call, after
+// its completion reported POLLOUT. The fd is reported again in case the
+// caller queues more output without changing its interest.
+ssize_t IoUringBackend::send(int fd, OutputQueue &output, bool closeAfter) {
+  Watch &watch = watches[fd];
+  if (watch.sent == true) {
+    watch.sent = false;
+    markPending(fd);
+    if (watch.result < 0) {
+      errno = -watch.result;
+      return -1;
+    }
+    output.consume(watch.result);
+    return watch.result;
+  }
+  errno = EAGAIN;
+  if (watch.sending == true || watch.polling == true)
+    return -1;
+  // No io_uring request sends a file region to a socket, sendfile does
+  if (output.fileFirst() == true) {
+    ssize_t bytesSend = output.flush(fd);
+    if (bytesSend == -1 && errno == EAGAIN) {
+      watch.polling = true;
+      pollAdd(fd, POLLOUT, false);
+    }
+    return bytesSend;
+  }
+
+  if (watch.iov.empty() == true)
+    watch.iov.resize(maxIovecs);
+  size_t length;
+  int count = output.gather(watch.iov.data(), maxIovecs, length);
+  size_t sum = 0;
+  for (int i = 0; i < count; i++) {
+    if (sum + watch.iov[i].iov_len >= maxSendBytes) {
+      watch.iov[i].iov_len = maxSendBytes - sum;
+      length = maxSendBytes;
+      count = i + 1;
+      break;
+    }
+    sum += watch.iov[i].iov_len;
+  }
+  watch.message.msg_iov = watch.iov.data();
+  watch.message.msg_iovlen = count;
+  watch.length = length;
+  watch.sending = true;
+
+  // MSG_WAITALL: a short send breaks the link, the socket stays open
+  bool linkClose = closeAfter == true && length == output.size();
+  makeRoom(linkClose ? 3 : 1);
+  struct io_uring_sqe *sqe = nextSqe();
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<unsigned long long>(&watch.message);
+  sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+  sqe->user_data = makeTag(KIND_SEND, fd, watch.generation);
+  if (linkClose == true) {
+    sqe->flags = IOSQE_IO_LINK;
+    closeSocket(fd);
+    watch.closing = true;
+  }
+  errno = EAGAIN;
+  return -1;
+}
+
+int IoUringBackend::close(int fd, OutputQueue &output) {
+  Watch &watch = this->watch(fd);
+  if (watch.role == ROLE_POLL || watch.role == ROLE_NONE) {
+    remove(fd);
+    return ::close(fd);
+  }
+  if (watch.sending == true) {
+    // Cancelled sends report what they sent, the orphan completes the close
+    unsigned long long tag = makeTag(KIND_SEND, fd, watch.generation);
+    Orphan &orphan = orphans[tag];
+    orphan.fd = fd;
+    orphan.linkedClose = watch.closing;
+    orphan.length = watch.length;
+    orphan.output.swap(output);
+    cancel(tag);
+  } else if (watch.closing == false) {
+    closeSocket(fd);
+  }
+  // The poll request holds the socket open until it completes
+  if (watch.polling == true)
+    cancel(makeTag(KIND_POLL, fd, watch.generation));
+  reset(watch);
+  for (size_t i = 0; i < listeners.size(); i++) {
+    if (watches[listeners[i]].accepted.empty() == false)
+      markPending(listeners[i]);
+  }
+  return 0;
+}
+
+// Completions
+
+void IoUringBackend::completePoll(Watch &watch, int fd,
+                                  const struct io_uring_cqe &cqe) {
+  if (watch.role == ROLE_CONNECTION) {
+    watch.polling = false;
+  } else if (!(cqe.flags & IORING_CQE_F_MORE) && cqe.res >= 0) {
+    // The kernel stopped the multishot request (e.g. on CQ overflow), arm a
+    // fresh one. An error on the live request is reported as POLLERR.
+    pollAdd(fd, watch.interest, true);
+  }
+  watch.revents |= cqe.res < 0 ? POLLERR : static_cast<short>(cqe.res);
+}
+
+void IoUringBackend::completeAccept(Watch &watch, int fd,
+                                    const struct io_uring_cqe &cqe) {
+  (void)fd;
+  if (cqe.res >= 0)
+    watch.accepted.push_back(cqe.res);
+  else if (cqe.res != -ECANCELED)
+    watch.error = -cqe.res;
+  // Armed again by the accept that finds the queue empty, so running out of
+  // descriptors does not spin
+  if (!(cqe.flags & IORING_CQE_F_MORE))
+    watch.armed = false;
+}
+
+void IoUringBackend::completeRecv(Watch &watch, int fd,
+                                  const struct io_uring_cqe &cqe) {
+  if (cqe.res > 0) {
+    Chunk chunk = {static_cast<unsigned short>(cqe.flags >>
+                                               IORING_CQE_BUFFER_SHIFT),
+                   static_cast<unsigned>(cqe.res)};
+    watch.input.push_back(chunk);
+    if (watch.input.size() >= maxHeldBuffers && watch.armed &&
+        watch.cancelled == false && (cqe.flags & IORING_CQE_F_MORE)) {
+      watch.cancelled = true;
+      cancel(makeTag(KIND_RECV, fd, watch.generation));
+    }
+  } else if (cqe.res == 0) {
+    watch.eof = true;
+  } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+    watch.error = -cqe.res;
+  }
+  if (!(cqe.flags & IORING_CQE_F_MORE)) {
+    watch.armed = false;
+    if (cqe.res == -ENOBUFS)
+      resumeRecv(fd);
+  }
+}
+
+void IoUringBackend::completeSend(Watch &watch, int fd,
+                                  const struct io_uring_cqe &cqe) {
+  (void)fd;
+  watch.sending = false;
+  watch.sent = true;
+  watch.result = cqe.res;
+  if (cqe.res != static_cast<int>(watch.length))
+    watch.closing = false;
+}
+
+int IoUringBackend::wait(std::vector<struct pollfd> &ready, int timeoutMs) {
+  ready.clear();
+
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  unsigned flags = IORING_ENTER_EXT_ARG | IORING_ENTER_GETEVENTS;
+  unsigned minComplete = 0;
+  unsigned head = *cqHead;
+  if (timeoutMs != 0 && pending.empty() == true &&
+      head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+    minComplete = 1;
+    if (timeoutMs > 0) {
+      ts.tv_sec = timeoutMs / 1000;
+      ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+      arg.ts = reinterpret_cast<unsigned long long>(&ts);
+    }
+  }
+  if (queued() != 0 || minComplete != 0) {
+    int ret = enter(queued(), minComplete, flags, &arg, sizeof(arg));
+    if (ret < 0 && errno != EINTR && errno != ETIME && errno != EBUSY)
+      return -1;
+  }
+
+  unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+  for (; head != tail; head++) {
+    const struct io_uring_cqe &cqe = cqes[head & *cqMask];
+    Kind kind = static_cast<Kind>(cqe.user_data >> 56);
+    int fd = static_cast<int>(cqe.user_data & 0xffffffffULL);
+    unsigned tag = static_cast<unsigned>(cqe.user_data >> 32) & 0xffffff;
+    if (cqe.flags & IORING_CQE_F_BUFFER)
+      heldBuffers++;
+    if (kind == KIND_IGNORE)
+      continue;
+
+    bool live = static_cast<size_t>(fd) < watches.size() &&
+                tag == (watches[fd].generation & 0xffffff);
+    if (live == false) {
+      if (cqe.flags & IORING_CQE_F_BUFFER)
+        provideBuffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+      else if (kind == KIND_ACCEPT && cqe.res >= 0)
+        ::close(cqe.res);
+      std::map<unsigned long long, Orphan>::iterator orphan =
+          orphans.find(cqe.user_data);
+      if (orphan != orphans.end()) {
+        Orphan &sent = orphan->second;
+        if (sent.linkedClose == false ||
+            cqe.res != static_cast<int>(sent.length))
+          closeSocket(sent.fd);
+        orphans.erase(orphan);
+      }
+      continue;
+    }
+
+    Watch &watch = watches[fd];
+    if (kind == KIND_POLL)
+      completePoll(watch, fd, cqe);
+    else if (kind == KIND_ACCEPT)
+      completeAccept(watch, fd, cqe);
+    else if (kind == KIND_RECV)
+      completeRecv(watch, fd, cqe);
+    else if (kind == KIND_SEND)
+      completeSend(watch, fd, cqe);
+    markPending(fd);
+  }
+  __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+  // Buffers read since the ring ran dry go to connections that waited
+  while (starved.empty() == false && heldBuffers < bufferCount) {
+    int fd = starved.back();
+    starved.pop_back();
+    watches[fd].starved = false;
+    if (watches[fd].role == ROLE_CONNECTION)
+      resumeRecv(fd);
+  }
+
+  for (size_t i = 0; i < pending.size(); i++) {
+    Watch &watch = watches[pending[i]];
+    watch.reported = false;
+    short revents = watch.interest == -1 ? 0 : readiness(watch);
+    if (revents != 0) {
+      struct pollfd pollfd = {pending[i], 0, revents};
+      ready.push_back(pollfd);
+    }
+  }
+  pending.clear();
+  return ready.size();
+}
+
+bool IoUringBackend::isEdgeTriggered() const { return true; }
+
+const char *IoUringBackend::name() const { return "io_uring"; }
+
+#endif // WEBSERV_IO_URING
@@ -0,0 +1,142 @@
+#ifndef IO_URING_BACKEND_HPP
+#define IO_URING_BACKEND_HPP
+
+#ifdef WEBSERV_IO_URING
+
+#include "EventBackend.hpp"
+#include "OutputQueue.hpp"
+#include <deque>
+#include <linux/io_uring.h>
+#include <map>
+#include <sys/socket.h>
+
+// io_uring(7) completion backend, built with `make IO_URING=1` (Linux 6.0 or
+// newer). Listeners run a multishot accept, connections a multishot recv
+// into a ring of provided buffers, and responses go out as sendmsg requests,
+// the last one of a connection linked to the close of its socket. accept,
+// receive and send hand out what those requests completed, so SocketManager
+// keeps its pollin/pollout flow while the steady state costs one
+// io_uring_enter per loop pass. File regions still go out with sendfile, a
+// one-shot poll request waits when the socket is full. Other fds get a
+// multishot poll request.
+class IoUringBackend : public EventBackend {
+	private:
+	enum Role { ROLE_NONE, ROLE_POLL, ROLE_LISTENER, ROLE_CONNECTION };
+
+	struct Chunk {
+		unsigned short id; // provided buffer
+		unsigned length;
+	};
+
+	struct Watch {
+		unsigned generation; // tag of the fd's live requests
+		short interest;      // current mask, -1 if unwatched
+		Role role;
+		short revents;     // poll results not reported yet
+		bool reported;     // queued in pending
+		bool armed;        // multishot accept, recv or poll still live
+		bool cancelled;    // recv stopped while it holds too many buffers
+		bool starved;      // recv ended on an empty buffer ring
+		bool polling;      // waits for POLLOUT before a sendfile region
+		bool sending;      // sendmsg in flight
+		bool sent;         // its result waits in result
+		bool closing;      // close linked behind the send in flight
+		bool eof;
+		int error;
+		int result;
+		size_t length;           // bytes of the send in flight
+		size_t inputOffset;      // bytes of the front chunk handed out
+		std::deque<Chunk> input; // received, not read yet
+		std::deque<int> accepted;
+		std::vector<struct iovec> iov;
+		struct msghdr message;
+
+		Watch();
+	};
+
+	// Output of a socket closed while a send still read from it, freed with
+	// the send's completion
+	struct Orphan {
+		int fd;
+		bool linkedClose;
+		size_t length;
+		OutputQueue output;
+	};
+
+	int ringFd;
+	void *sqRing;
+	void *cqRing;
+	size_t sqRingSize;
+	size_t cqRingSize;
+	struct io_uring_sqe *sqes;
+	size_t sqesSize;
+
+	unsigned *sqHead;
+	unsigned *sqTail;
+	unsigned *sqMask;
+	unsigned *sqArray;
+	unsigned *cqHead;
+	unsigned *cqTail;
+	unsigned *cqMask;
+	struct io_uring_cqe *cqes;
+
+	struct io_uring_buf_ring *bufferRing;
+	char *bufferMemory;
+	unsigned short bufferTail;
+	unsigned heldBuffers; // handed out by completions, not provided again
+
+	std::deque<Watch> watches; // by fd, a deque so msghdrs never move
+	std::vector<int> pending;  // fds whose readiness is reported next wait
+	std::vector<int> starved;
+	std::vector<int> listeners;
+	std::map<unsigned long long, Orphan> orphans;
+
+	void release();
+	unsigned queued() const;
+	void makeRoom(unsigned count);
+	struct io_uring_sqe *nextSqe();
+	int enter(unsigned toSubmit, unsigned minComplete, unsigned flags,
+	          void *arg, size_t argSize);
+	Watch &watch(int fd);
+	void reset(Watch &watch);
+	void markPending(int fd);
+	short readiness(Watch &watch);
+
+	void pollAdd(int fd, short events, bool multishot);
+	void pollRemove(int fd);
+	void armAccept(int fd);
+	void armRecv(int fd);
+	void resumeRecv(int fd);
+	void cancel(unsigned long long tag);
+	void closeSocket(int fd);
+	void provideBuffer(unsigned short id);
+
+	void completePoll(Watch &watch, int fd, const struct io_uring_cqe &cqe);
+	void completeAccept(Watch &watch, int fd, const struct io_uring_cqe &cqe);
+	void completeRecv(Watch &watch, int fd, const struct io_uring_cqe &cqe);
+	void completeSend(Watch &watch, int fd, const struct io_uring_cqe &cqe);
+
+	public:
+	IoUringBackend();
+	~IoUringBackend();
+
+	void add(int fd, short events);
+	void modify(int fd, short events);
+	void remove(int fd);
+	void addShared(int fd);
+	void addListener(int fd);
+	void addConnection(int fd);
+
+	int accept(int listenFd);
+	ssize_t receive(int fd, char *buffer, size_t length);
+	ssize_t send(int fd, OutputQueue &output, bool closeAfter);
+	int close(int fd, OutputQueue &output);
+
+	int wait(std::vector<struct pollfd> &ready, int timeoutMs);
+	bool isEdgeTriggered() const;
+	const char *name() const;
+};
+
+#endif // WEBSERV_IO_URING
+
+#endif // IO_URING_BACKEND_HPP
@@ -16,6 +16,10 @@ Lexer::Lexer(const char *filename) : filepath(filename) {
 	directive_lookup["location"] = LOCATION;
 	directive_lookup["methods"] = METHODS;
 	directive_lookup["redirect"] = REDIRECT;
+	directive_lookup["event_backend"] = EVENT_BACKEND;
+	directive_lookup["workers"] = WORKERS;
+	directive_lookup["worker_mode"] = WORKER_MODE;
+	directive_lookup["mmap_threshold"] = MMAP_THRESHOLD;
 	directive_lookup["{"] = OPEN_CURLY_BRACKET;
 	directive_lookup["}"] = CLOSED_CURLY_BRACKET;
 	directive_lookup[";"] = SEMICOLON;
@@ -112,6 +116,10 @@ void Lexer::parseString(const std::string &line) {
       case DIR_LISTING:
       case CLIENT_BODY_SIZE:
       case REDIRECT:
+      case EVENT_BACKEND:
+      case WORKERS:
+      case WORKER_MODE:
+      case MMAP_THRESHOLD:
         createToken(it, words, node);
         break;
       case LOCATION:
@@ -0,0 +1,225 @@
+#include "MultipartUpload.hpp"
+#include "EventLogger.hpp"
+#include "Scanner.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Part headers are a few lines, anything past this is not a form upload
+static const size_t maxHeadSize = 8192;
+// RFC 2046 caps boundaries at 70 characters
+static const size_t maxBoundary = 70;
+
+MultipartUpload::MultipartUpload() : state(INACTIVE), existed(false), files(0) {}
+
+MultipartUpload::~MultipartUpload() { abort(); }
+
+std::string MultipartUpload::boundaryOf(std::string_view contentType) {
+  size_t at = contentType.find("boundary=");
+  if (at == std::string_view::npos)
+    return "";
+  std::string_view boundary = contentType.substr(at + 9);
+  boundary = boundary.substr(0, boundary.find(';'));
+  if (boundary.size() >= 2 && boundary.front() == '"' && boundary.back() == '"')
+    boundary = boundary.substr(1, boundary.size() - 2);
+  if (boundary.size() > maxBoundary)
+    return "";
+  return std::string(boundary);
+}
+
+void MultipartUpload::begin(const std::string &boundary,
+                            const std::string &directory) {
+  reset();
+  this->directory = directory;
+  delimiter = "\r\n--" + boundary;
+  // The first delimiter opens the body without a line break before it
+  carry = "\r\n";
+  state = PREAMBLE;
+}
+
+void MultipartUpload::feed(std::string_view input) {
+  while (input.empty() == false && state != FINISHED && state != FAILED) {
+    if (carry.empty() == true) {
+      step(input);
+      return;
+    }
+    // Join the held back tail with the start of input so a delimiter split
+    // across reads is seen whole, then go on from wherever that stopped
+    size_t take = std::min(input.size(), delimiter.size() * 2);
+    std::string window = carry;
+    window.append(input.substr(0, take));
+    carry.clear();
+    step(window);
+    if (carry.size() > take)
+      return;
+    input.remove_prefix(take - carry.size());
+    carry.clear();
+  }
+}
+
+void MultipartUpload::step(std::string_view input) {
+  while (input.empty() == false) {
+    switch (state) {
+    case PREAMBLE:
+    case DATA: {
+      size_t found = Scanner::find(input, delimiter);
+      if (found == Scanner::npos) {
+        size_t keep = partialDelimiter(input);
+        write(input.substr(0, input.size() - keep));
+        carry.assign(input.substr(input.size() - keep));
+        return;
+      }
+      write(input.substr(0, found));
+      closePart();
+      input.remove_prefix(found + delimiter.size());
+      state = DELIMITER_TAIL;
+      break;
+    }
+    case DELIMITER_TAIL:
+      if (input.size() < 2) {
+        carry.assign(input);
+        return;
+      }
+      if (input.compare(0, 2, "--") == 0) {
+        state = FINISHED;
+        return;
+      }
+      if (input.compare(0, 2, "\r\n") != 0) {
+        fail();
+        return;
+      }
+      // The line break stays, so a part without headers ends in CRLF CRLF
+      head.clear();
+      state = HEADERS;
+      break;
+    case HEADERS: {
+      size_t before = head.size();
+      size_t take = std::min(input.size(), maxHeadSize - before);
+      head.append(input.substr(0, take));
+      size_t end = head.find("\r\n\r\n", before < 3 ? 0 : before - 3);
+      if (end == std::string::npos) {
+        if (head.size() == maxHeadSize) {
+          fail();
+          return;
+        }
+        input.remove_prefix(take);
+        break;
+      }
+      input.remove_prefix(end + 4 - before);
+      head.resize(end);
+      openPart();
+      break;
+    }
+    default:
+      return;
+    }
+  }
+}
+
+// Length of the longest input suffix that is a delimiter prefix
+size_t MultipartUpload::partialDelimiter(std::string_view input) const {
+  size_t length = std::min(input.size(), delimiter.size() - 1);
+  for (; length > 0; --length) {
+    if (input.compare(input.size() - length, length, delimiter, 0, length) == 0)
+      break;
+  }
+  return length;
+}
+
+void MultipartUpload::openPart() {
+  state = DATA;
+  size_t at = head.find("filename=\"");
+  if (at == std::string::npos)
+    return; // a plain form field, its value is not kept
+  at += 10;
+  size_t end = head.find('"', at);
+  if (end == std::string::npos)
+    return;
+  std::string name = head.substr(at, end - at);
+  size_t slash = name.find_last_of("/\\");
+  if (slash != std::string::npos)
+    name.erase(0, slash + 1);
+  if (name.empty() == true || name == "." || name == "..")
+    return;
+
+  std::string target = directory + name;
+  bool first = firstPath.empty();
+  if (first == true)
+    firstPath = target;
+  int fd = open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd == -1 && errno == EEXIST) {
+    if (first == true)
+      existed = true;
+    return;
+  }
+  if (fd == -1) {
+    WARNING("Unable to open file for writing: " << target << ": "
+                                                 << strerror(errno));
+    fail();
+    return;
+  }
+  file = std::make_shared<OpenFile>(fd);
+  path = target;
+}
+
+void MultipartUpload::write(std::string_view data) {
+  if (state != DATA || !file)
+    return;
+  while (data.empty() == false) {
+    ssize_t written = ::write(file->fd, data.data(), data.size());
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0) {
+      WARNING("Failed to write file: " << path << ": " << strerror(errno));
+      fail();
+      return;
+    }
+    data.remove_prefix(written);
+  }
+}
+
+void MultipartUpload::closePart() {
+  if (!file)
+    return;
+  file.reset();
+  path.clear();
+  ++files;
+}
+
+void MultipartUpload::fail() {
+  abort();
+  state = FAILED;
+}
+
+void MultipartUpload::abort() {
+  if (!file)
+    return;
+  file.reset();
+  unlink(path.c_str());
+  path.clear();
+}
+
+void MultipartUpload::reset() {
+  abort();
+  state = INACTIVE;
+  delimiter.clear();
+  directory.clear();
+  carry.clear();
+  head.clear();
+  firstPath.clear();
+  existed = false;
+  files = 0;
+}
+
+bool MultipartUpload::active() const { return state != INACTIVE; }
+
+bool MultipartUpload::finished() const { return state == FINISHED; }
+
+bool MultipartUpload::failed() const { return state == FAILED; }
+
+const std::string &MultipartUpload::firstFile() const { return firstPath; }
+
+bool MultipartUpload::firstExisted() const { return existed; }
+
+size_t MultipartUpload::saved() const { return files; }
@@ -0,0 +1,64 @@
+#ifndef MULTIPART_UPLOAD_HPP
+#define MULTIPART_UPLOAD_HPP
+
+#include "OutputQueue.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Streaming multipart/form-data parser. Body bytes are fed as they arrive
+// and every part that carries a filename is written straight to its file;
+// only a delimiter split across reads and the part headers are held back,
+// so memory stays at a few hundred bytes whatever the upload size.
+class MultipartUpload {
+	public:
+	MultipartUpload();
+	~MultipartUpload();
+
+	// Boundary parameter of a Content-Type value, empty if there is none
+	static std::string boundaryOf(std::string_view contentType);
+
+	void begin(const std::string &boundary, const std::string &directory);
+	// Takes all of input, a delimiter cut at its end is carried over
+	void feed(std::string_view input);
+	// Removes the file of a part that was not received completely
+	void abort();
+	void reset();
+
+	bool active() const;
+	bool finished() const; // closing delimiter seen
+	bool failed() const;
+	const std::string &firstFile() const; // path of the first file part
+	bool firstExisted() const;            // it was there already, kept as is
+	size_t saved() const;                 // files written completely
+
+	private:
+	enum State {
+		INACTIVE,
+		PREAMBLE,
+		DELIMITER_TAIL,
+		HEADERS,
+		DATA,
+		FINISHED,
+		FAILED
+	};
+	State state;
+	std::string delimiter; // CRLF "--" boundary
+	std::string directory;
+	std::string carry; // input tail that may start a delimiter
+	std::string head;  // headers of the current part
+	std::shared_ptr<OpenFile> file; // current part, null when it is skipped
+	std::string path;
+	std::string firstPath;
+	bool existed;
+	size_t files;
+
+	void step(std::string_view input);
+	size_t partialDelimiter(std::string_view input) const;
+	void openPart();
+	void write(std::string_view data);
+	void closePart();
+	void fail();
+};
+
+#endif // MULTIPART_UPLOAD_HPP
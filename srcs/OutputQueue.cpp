@@ -0,0 +1,173 @@
+#include "OutputQueue.hpp"
+#include <algorithm>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+static const int maxIovecs = 64;
+
+OpenFile::OpenFile(int fd) : fd(fd) {}
+
+OpenFile::~OpenFile() {
+  if (fd != -1)
+    close(fd);
+}
+
+MappedFile::MappedFile(const char *data, size_t size)
+    : data(data), size(size) {}
+
+MappedFile::~MappedFile() {
+  if (data != NULL)
+    munmap(const_cast<char *>(data), size);
+}
+
+OutputQueue::OutputQueue() : cursor(0), queued(0) {}
+
+OutputQueue::~OutputQueue() {}
+
+void OutputQueue::append(std::string data) {
+  if (data.empty() == true)
+    return;
+  queued += data.size();
+  segments.push_back(Segment());
+  segments.back().buffer.swap(data);
+}
+
+void OutputQueue::appendShared(
+    const std::shared_ptr<const std::string> &data) {
+  if (!data || data->empty() == true)
+    return;
+  queued += data->size();
+  segments.push_back(Segment());
+  segments.back().shared = data;
+}
+
+void OutputQueue::appendFile(const std::shared_ptr<OpenFile> &file,
+                             off_t offset, off_t length) {
+  if (length <= 0)
+    return;
+  queued += length;
+  segments.push_back(Segment());
+  segments.back().file = file;
+  segments.back().offset = offset;
+  segments.back().end = offset + length;
+}
+
+void OutputQueue::appendMapped(const std::shared_ptr<const MappedFile> &mapping,
+                               off_t offset, off_t length) {
+  if (!mapping || length <= 0)
+    return;
+  queued += length;
+  segments.push_back(Segment());
+  segments.back().mapping = mapping;
+  segments.back().offset = offset;
+  segments.back().end = offset + length;
+}
+
+std::string_view OutputQueue::bytes(const Segment &segment) const {
+  if (segment.mapping)
+    return std::string_view(segment.mapping->data + segment.offset,
+                            segment.end - segment.offset);
+  if (segment.shared)
+    return *segment.shared;
+  return segment.buffer;
+}
+
+// Memory segments up to the next file region go out in one writev
+ssize_t OutputQueue::flush(int socketFd) {
+  if (segments.empty() == true)
+    return 0;
+  if (segments.front().file)
+    return flushFile(socketFd);
+
+  struct iovec iov[maxIovecs];
+  size_t length;
+  struct msghdr message = {};
+  message.msg_iov = iov;
+  message.msg_iovlen = gather(iov, maxIovecs, length);
+  // sendmsg instead of writev: a peer that went away must not raise SIGPIPE
+  ssize_t bytesSend = sendmsg(socketFd, &message, MSG_NOSIGNAL);
+  if (bytesSend > 0)
+    consume(bytesSend);
+  return bytesSend;
+}
+
+int OutputQueue::gather(struct iovec *iov, int max, size_t &length) const {
+  int count = 0;
+  size_t skip = cursor;
+  length = 0;
+  std::deque<Segment>::const_iterator it;
+  for (it = segments.begin(); it != segments.end() && count < max; it++) {
+    if (it->file)
+      break;
+    std::string_view data = bytes(*it);
+    iov[count].iov_base = const_cast<char *>(data.data() + skip);
+    iov[count].iov_len = data.size() - skip;
+    length += iov[count].iov_len;
+    skip = 0;
+    count++;
+  }
+  return count;
+}
+
+bool OutputQueue::fileFirst() const {
+  return segments.empty() == false && segments.front().file;
+}
+
+ssize_t OutputQueue::flushFile(int socketFd) {
+  Segment &segment = segments.front();
+  size_t count = static_cast<size_t>(segment.end - segment.offset);
+#ifdef __linux__
+  ssize_t bytesSend = sendfile(socketFd, segment.file->fd, &segment.offset,
+                               count);
+#else
+  char buffer[4096 * 4];
+  ssize_t bytesRead = pread(segment.file->fd, buffer,
+                            std::min(count, sizeof(buffer)), segment.offset);
+  if (bytesRead <= 0)
+    return bytesRead;
+  ssize_t bytesSend = send(socketFd, buffer, bytesRead, 0);
+  if (bytesSend > 0)
+    segment.offset += bytesSend;
+#endif
+  if (bytesSend > 0) {
+    queued -= bytesSend;
+    if (segment.offset >= segment.end)
+      segments.pop_front();
+  }
+  return bytesSend;
+}
+
+void OutputQueue::consume(size_t count) {
+  queued -= count;
+  while (count > 0) {
+    size_t left = bytes(segments.front()).size() - cursor;
+    if (count < left) {
+      cursor += count;
+      return;
+    }
+    count -= left;
+    cursor = 0;
+    segments.pop_front();
+  }
+}
+
+bool OutputQueue::empty() const { return segments.empty(); }
+
+size_t OutputQueue::size() const { return queued; }
+
+void OutputQueue::clear() {
+  segments.clear();
+  cursor = 0;
+  queued = 0;
+}
+
+void OutputQueue::swap(OutputQueue &other) {
+  segments.swap(other.segments);
+  std::swap(cursor, other.cursor);
+  std::swap(queued, other.queued);
+}
@@ -0,0 +1,83 @@
+#ifndef OUTPUT_QUEUE_HPP
+#define OUTPUT_QUEUE_HPP
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// Closes the descriptor once the last file segment referencing it is sent
+struct OpenFile {
+	int fd;
+
+	explicit OpenFile(int fd);
+	~OpenFile();
+
+	private:
+	OpenFile(const OpenFile &);
+	OpenFile &operator=(const OpenFile &);
+};
+
+// Read-only mapping of a whole file, unmapped when the last segment and the
+// cache let go of it
+struct MappedFile {
+	const char *data;
+	size_t size;
+
+	MappedFile(const char *data, size_t size);
+	~MappedFile();
+
+	private:
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+};
+
+// Pending response bytes of one connection. Memory and mapped segments are
+// flushed together with writev and file regions with sendfile; a cursor
+// walks the front segment so a partial send never moves the bytes that are
+// left.
+class OutputQueue {
+	private:
+	struct Segment {
+		std::string buffer;                        // owned header or body
+		std::shared_ptr<const std::string> shared; // immutable, shared bytes
+		std::shared_ptr<OpenFile> file;            // region [offset, end)
+		std::shared_ptr<const MappedFile> mapping; // region [offset, end)
+		off_t offset;
+		off_t end;
+	};
+	std::deque<Segment> segments;
+	size_t cursor; // bytes of the front memory segment already sent
+	size_t queued; // bytes left to send
+
+	std::string_view bytes(const Segment &segment) const;
+	ssize_t flushFile(int socketFd);
+
+	public:
+	OutputQueue();
+	~OutputQueue();
+
+	void append(std::string data);
+	void appendShared(const std::shared_ptr<const std::string> &data);
+	void appendFile(const std::shared_ptr<OpenFile> &file, off_t offset,
+	                off_t length);
+	void appendMapped(const std::shared_ptr<const MappedFile> &mapping,
+	                  off_t offset, off_t length);
+
+	// Bytes sent, -1 with errno set, 0 when a file ended before its region
+	ssize_t flush(int socketFd);
+	// For a send that completes later: the memory segments up to the next
+	// file region as at most max iovecs, which stay valid until consume
+	int gather(struct iovec *iov, int max, size_t &length) const;
+	bool fileFirst() const;
+	void consume(size_t count);
+	bool empty() const;
+	size_t size() const;
+	void clear();
+	// Segments change owner without moving, iovecs into them stay valid
+	void swap(OutputQueue &other);
+};
+
+#endif // OUTPUT_QUEUE_HPP
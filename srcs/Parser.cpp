@@ -13,6 +13,7 @@
 #include "Parser.hpp"
 
 Parser::Parser(std::vector<lexer_node> lexer) : lexer(lexer) {
+  http.clear();
   parseConfigurations(this->lexer);
   parseMimeTypes(mimeTypeFilePath);
 }
@@ -21,6 +22,58 @@ Parser::~Parser() {}
 
 std::vector<ServerParser> Parser::getParser() const { return this->servers; }
 
+HttpConfig Parser::getHttpConfig() const { return this->http; }
+
+//-->Http features
+void Parser::parseEventBackend(std::vector<lexer_node>::iterator &it) {
+  if (it->value != "epoll" && it->value != "poll" && it->value != "io_uring")
+    throw std::runtime_error("Unknown event backend: " + it->value);
+#ifndef WEBSERV_IO_URING
+  if (it->value == "io_uring")
+    throw std::runtime_error(
+        "io_uring event backend needs a build with make IO_URING=1!");
+#endif
+  http.event_backend = it->value;
+  if ((it + 1) != lexer.end() && (it + 1)->type != SEMICOLON)
+    throw std::runtime_error("Event backend is missing a semi-colon!");
+}
+
+void Parser::parseWorkers(std::vector<lexer_node>::iterator &it) {
+  int workers;
+  std::istringstream iss(it->value);
+  if (!(iss >> workers)) {
+    throw std::runtime_error("Invalid integer for workers!");
+  } else if (!iss.eof()) {
+    throw std::runtime_error("Invalid format for workers!");
+  }
+  if (workers < 1 || workers > 256)
+    throw std::runtime_error("Workers must be between 1 and 256!");
+  http.workers = workers;
+  if ((it + 1) != lexer.end() && (it + 1)->type != SEMICOLON)
+    throw std::runtime_error("Workers is missing a semi-colon!");
+}
+
+void Parser::parseWorkerMode(std::vector<lexer_node>::iterator &it) {
+  if (it->value != "thread" && it->value != "process")
+    throw std::runtime_error("Unknown worker mode: " + it->value);
+  http.worker_mode = it->value;
+  if ((it + 1) != lexer.end() && (it + 1)->type != SEMICOLON)
+    throw std::runtime_error("Worker mode is missing a semi-colon!");
+}
+
+void Parser::parseMmapThreshold(std::vector<lexer_node>::iterator &it) {
+  size_t size;
+  std::istringstream iss(it->value);
+  if (!(iss >> size)) {
+    throw std::runtime_error("Invalid Num for mmap threshold!");
+  } else if (!iss.eof()) {
+    throw std::runtime_error("Invalid format for mmap threshold!");
+  }
+  http.mmap_threshold = size;
+  if ((it + 1) != lexer.end() && (it + 1)->type != SEMICOLON)
+    throw std::runtime_error("Mmap threshold is missing a semi-colon!");
+}
+
 //-->Server features
 void Parser::parseKeepaliveTimeout(std::vector<lexer_node>::iterator &it,
                                    ServerParser &server) {
@@ -9,6 +9,7 @@ class Parser {
 	private:
 		std::vector<lexer_node> lexer;
 		std::vector<ServerParser> servers;
+		HttpConfig http;
 
 	public:
 		// construction n destruction
@@ -17,12 +18,18 @@ class Parser {
 
 		// getter
 		std::vector<ServerParser> getParser() const;
+		HttpConfig getHttpConfig() const;
 
 		// General functions
 		void parseConfigurations(std::vector<lexer_node> &lexa);
 
 		//-->Server features
 		void parseHttpBlock(std::vector<lexer_node>::iterator &it, int &countCurlBrackets);
+		void parseEventBackend(std::vector<lexer_node>::iterator &it);
+		void parseWorkers(std::vector<lexer_node>::iterator &it);
+		void parseWorkerMode(std::vector<lexer_node>::iterator &it);
+		void parseMmapThreshold(std::vector<lexer_node>::iterator &it);
+		void finaliseHttp();
 		void parseServerBlock(std::vector<lexer_node>::iterator &it, int &countCurlBrackets);
 		void parseKeepaliveTimeout(std::vector<lexer_node>::iterator &it, ServerParser &server);
 		void parseSendTimeout(std::vector<lexer_node>::iterator &it, ServerParser &server);
@@ -12,6 +12,14 @@
 
 #include "Parser.hpp"
 
+void Parser::finaliseHttp() {
+  if (http.event_backend == "")
+    http.event_backend = "epoll";
+  if (http.workers == 0)
+    http.workers = 1;
+  if (http.worker_mode == "")
+    http.worker_mode = "thread";
+}
 
 void Parser::finaliseServer(ServerParser &server) {
   if (server.keepalive_timeout == 0)
@@ -120,6 +128,18 @@ void Parser::parseConfigurations(std::vector<lexer_node> &lexa) {
     case (SERVERBLOCK):
       parseServerBlock(it, countCurlBrackets);
       break;
+    case (EVENT_BACKEND):
+      parseEventBackend(it);
+      break;
+    case (WORKERS):
+      parseWorkers(it);
+      break;
+    case (WORKER_MODE):
+      parseWorkerMode(it);
+      break;
+    case (MMAP_THRESHOLD):
+      parseMmapThreshold(it);
+      break;
     case (OPEN_CURLY_BRACKET):
       countCurlBrackets++;
       break;
@@ -138,6 +158,7 @@ void Parser::parseConfigurations(std::vector<lexer_node> &lexa) {
   }
   if (servers.empty() == true)
     throw std::runtime_error("Did you magically make server block disapper?");
+  finaliseHttp();
   SUCCESS("Parsing completed");
 }
 
@@ -0,0 +1,47 @@
+#include "PollBackend.hpp"
+#include <errno.h>
+
+PollBackend::PollBackend() {}
+
+PollBackend::~PollBackend() {}
+
+void PollBackend::add(int fd, short events) {
+  struct pollfd pollfd = {fd, events, 0};
+  if (static_cast<size_t>(fd) >= indexOf.size())
+    indexOf.resize(fd + 1, -1);
+  indexOf[fd] = pollFds.size();
+  pollFds.push_back(pollfd);
+}
+
+void PollBackend::modify(int fd, short events) {
+  if (static_cast<size_t>(fd) < indexOf.size() && indexOf[fd] != -1)
+    pollFds[indexOf[fd]].events = events;
+}
+
+// Swap with the last entry so removal does not shift the whole array
+void PollBackend::remove(int fd) {
+  if (static_cast<size_t>(fd) >= indexOf.size() || indexOf[fd] == -1)
+    return;
+  int index = indexOf[fd];
+  pollFds[index] = pollFds.back();
+  indexOf[pollFds[index].fd] = index;
+  pollFds.pop_back();
+  indexOf[fd] = -1;
+}
+
+int PollBackend::wait(std::vector<struct pollfd> &ready, int timeoutMs) {
+  ready.clear();
+  int count = poll(pollFds.data(), pollFds.size(), timeoutMs);
+  if (count <= 0)
+    return (count == -1 && errno == EINTR) ? 0 : count;
+
+  for (size_t i = 0; i < pollFds.size() && ready.size() < (size_t)count; i++) {
+    if (pollFds[i].revents != 0)
+      ready.push_back(pollFds[i]);
+  }
+  return ready.size();
+}
+
+bool PollBackend::isEdgeTriggered() const { return false; }
+
+const char *PollBackend::name() const { return "poll"; }
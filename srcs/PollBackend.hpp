@@ -0,0 +1,24 @@
+#ifndef POLL_BACKEND_HPP
+#define POLL_BACKEND_HPP
+
+#include "EventBackend.hpp"
+
+// Portable level triggered fallback built on poll(2)
+class PollBackend : public EventBackend {
+	private:
+	std::vector<struct pollfd> pollFds;
+	std::vector<int> indexOf; // fd -> position in pollFds, -1 if absent
+
+	public:
+	PollBackend();
+	~PollBackend();
+
+	void add(int fd, short events);
+	void modify(int fd, short events);
+	void remove(int fd);
+	int wait(std::vector<struct pollfd> &ready, int timeoutMs);
+	bool isEdgeTriggered() const;
+	const char *name() const;
+};
+
+#endif // POLL_BACKEND_HPP
@@ -0,0 +1,189 @@
+#include "RequestParser.hpp"
+#include "Scanner.hpp"
+
+// RFC 9110 tchar
+static bool isToken(unsigned char c) {
+  if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      (c >= '0' && c <= '9'))
+    return true;
+  switch (c) {
+  case '!': case '#': case '$': case '%': case '&': case '\'': case '*':
+  case '+': case '-': case '.': case '^': case '_': case '`': case '|':
+  case '~':
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool isControl(unsigned char c) { return c < 0x20 || c == 0x7f; }
+
+RequestParser::RequestParser() { reset(); }
+
+RequestParser::~RequestParser() {}
+
+void RequestParser::reset() {
+  Span empty = {0, 0};
+  method = empty;
+  target = empty;
+  version = empty;
+  headers.clear();
+  length = 0;
+  state = METHOD;
+  position = 0;
+}
+
+std::string_view RequestParser::view(std::string_view data, const Span &span) {
+  return data.substr(span.offset, span.length);
+}
+
+// Takes the bytes up to stop as part of the current target or value
+void RequestParser::skip(std::string_view data, size_t stop) {
+  if (stop == position)
+    return;
+  if (state == TARGET) {
+    target.length += stop - position;
+  } else {
+    // Trailing whitespace is not part of the value
+    size_t last = stop;
+    while (last > position && (data[last - 1] == ' ' || data[last - 1] == '\t'))
+      last--;
+    if (last > position)
+      headers.back().value.length = last - headers.back().value.offset;
+  }
+  position = stop;
+}
+
+RequestParser::Result RequestParser::complete() {
+  state = DONE;
+  length = position;
+  return COMPLETE;
+}
+
+RequestParser::Result RequestParser::fail() {
+  state = FAILED;
+  return INVALID;
+}
+
+bool RequestParser::validVersion(std::string_view data) const {
+  std::string_view text = view(data, version);
+  return text.size() == 8 && text.substr(0, 5) == "HTTP/" &&
+         text[5] >= '0' && text[5] <= '9' && text[6] == '.' &&
+         text[7] >= '0' && text[7] <= '9';
+}
+
+RequestParser::Result RequestParser::parse(std::string_view data) {
+  if (state == DONE)
+    return COMPLETE;
+  if (state == FAILED)
+    return INVALID;
+
+  for (; position < data.size(); position++) {
+    // Long targets and values are skipped with a vector scan up to the
+    // next byte that needs a decision
+    if (state == TARGET || state == HEADER_VALUE) {
+      size_t stop = state == TARGET ? Scanner::findDelimiter(data, position)
+                                    : Scanner::findControl(data, position);
+      if (stop == Scanner::npos)
+        stop = data.size();
+      skip(data, stop);
+      if (position == data.size())
+        break;
+    }
+    unsigned char c = data[position];
+    switch (state) {
+    case METHOD:
+      // Empty lines ahead of a request are skipped
+      if (method.length == 0 && (c == '\r' || c == '\n')) {
+        method.offset = position + 1;
+      } else if (c == ' ' && method.length > 0) {
+        target.offset = position + 1;
+        state = TARGET;
+      } else if (isToken(c) == true) {
+        method.length++;
+      } else {
+        return fail();
+      }
+      break;
+    case TARGET:
+      if (c == ' ' && target.length > 0) {
+        version.offset = position + 1;
+        state = VERSION;
+      } else if (c == ' ' || isControl(c) == true) {
+        return fail();
+      } else {
+        target.length++;
+      }
+      break;
+    case VERSION:
+      if (c == '\r' || c == '\n') {
+        if (validVersion(data) == false)
+          return fail();
+        state = c == '\r' ? REQUEST_LINE_LF : HEADER_START;
+      } else if (c == ' ' || isControl(c) == true) {
+        return fail();
+      } else {
+        version.length++;
+      }
+      break;
+    case REQUEST_LINE_LF:
+    case HEADER_LF:
+      if (c != '\n')
+        return fail();
+      state = HEADER_START;
+      break;
+    case HEADER_START:
+      if (c == '\r') {
+        state = HEAD_END_LF;
+      } else if (c == '\n') {
+        position++;
+        return complete();
+      } else if (isToken(c) == true && headers.size() < maxHeaders) {
+        // Folded (obsolete) continuation lines start with whitespace and
+        // are rejected here
+        Header header = {{position, 1}, {position, 0}};
+        headers.push_back(header);
+        state = HEADER_NAME;
+      } else {
+        return fail();
+      }
+      break;
+    case HEADER_NAME:
+      if (c == ':') {
+        state = HEADER_VALUE_START;
+      } else if (isToken(c) == true) {
+        headers.back().name.length++;
+      } else {
+        return fail();
+      }
+      break;
+    case HEADER_VALUE_START:
+      if (c == ' ' || c == '\t')
+        break;
+      headers.back().value.offset = position;
+      state = HEADER_VALUE;
+      // fall through
+    case HEADER_VALUE:
+      if (c == '\r') {
+        state = HEADER_LF;
+      } else if (c == '\n') {
+        state = HEADER_START;
+      } else if (isControl(c) == true && c != '\t') {
+        return fail();
+      } else if (c != ' ' && c != '\t') {
+        headers.back().value.length =
+            position + 1 - headers.back().value.offset;
+      }
+      break;
+    case HEAD_END_LF:
+      if (c != '\n')
+        return fail();
+      position++;
+      return complete();
+    case DONE:
+    case FAILED:
+      break;
+    }
+  }
+  return INCOMPLETE;
+}
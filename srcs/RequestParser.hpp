@@ -0,0 +1,64 @@
+#ifndef REQUEST_PARSER_HPP
+#define REQUEST_PARSER_HPP
+
+#include <string_view>
+#include <vector>
+
+// Resumable HTTP/1.1 request head parser. parse() is handed every unconsumed
+// byte of the connection each time more arrive and continues at the byte it
+// stopped on, so nothing is scanned twice. Fields are kept as offsets into
+// that data, which stay valid when the read buffer moves or grows, and are
+// read back as string_views with view().
+class RequestParser {
+	public:
+	enum Result { INCOMPLETE, COMPLETE, INVALID };
+
+	struct Span {
+		size_t offset;
+		size_t length;
+	};
+	struct Header {
+		Span name;
+		Span value; // without surrounding whitespace
+	};
+
+	static const size_t maxHeaders = 100;
+
+	Span method;
+	Span target;
+	Span version;
+	std::vector<Header> headers;
+	size_t length; // bytes of the request head, final blank line included
+
+	RequestParser();
+	~RequestParser();
+
+	Result parse(std::string_view data);
+	void reset();
+	static std::string_view view(std::string_view data, const Span &span);
+
+	private:
+	enum State {
+		METHOD,
+		TARGET,
+		VERSION,
+		REQUEST_LINE_LF,
+		HEADER_START,
+		HEADER_NAME,
+		HEADER_VALUE_START,
+		HEADER_VALUE,
+		HEADER_LF,
+		HEAD_END_LF,
+		DONE,
+		FAILED
+	};
+	State state;
+	size_t position; // next byte to look at
+
+	void skip(std::string_view data, size_t stop);
+	Result complete();
+	Result fail();
+	bool validVersion(std::string_view data) const;
+};
+
+#endif // REQUEST_PARSER_HPP
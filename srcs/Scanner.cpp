@@ -0,0 +1,347 @@
+#include "Scanner.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct Kernels {
+  size_t (*find)(const char *, size_t, const char *, size_t);
+  size_t (*findByte)(const char *, size_t, char);
+  size_t (*findControl)(const char *, size_t);
+  size_t (*findDelimiter)(const char *, size_t);
+  bool (*isUrlSafe)(const char *, size_t);
+  const char *isa;
+};
+
+/* ---------------------------------------------------------------- scalar */
+
+inline bool isControl(unsigned char c) { return c < 0x20 || c == 0x7f; }
+
+inline bool isUrlChar(unsigned char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '-' && c <= '9') || c == '_' || c == '~';
+}
+
+size_t findScalar(const char *data, size_t size, const char *needle,
+                  size_t length) {
+  return std::string_view(data, size).find(std::string_view(needle, length));
+}
+
+size_t findByteScalar(const char *data, size_t size, char byte) {
+  for (size_t i = 0; i < size; i++) {
+    if (data[i] == byte)
+      return i;
+  }
+  return Scanner::npos;
+}
+
+size_t findControlScalar(const char *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (isControl(data[i]) == true)
+      return i;
+  }
+  return Scanner::npos;
+}
+
+size_t findDelimiterScalar(const char *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (data[i] == ' ' || isControl(data[i]) == true)
+      return i;
+  }
+  return Scanner::npos;
+}
+
+bool isUrlSafeScalar(const char *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (isUrlChar(data[i]) == false)
+      return false;
+  }
+  return true;
+}
+
+#ifdef SCANNER_X86
+
+/* ------------------------------------------------------------------ SSE2 */
+
+// Needle search after W. Mula: a block position is a candidate when both the
+// first and the last needle byte match, candidates are verified with memcmp
+__attribute__((target("sse2"))) size_t findSse2(const char *data, size_t size,
+                                                const char *needle,
+                                                size_t length) {
+  if (length < 2 || length > size)
+    return findScalar(data, size, needle, length);
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[length - 1]);
+  size_t i = 0;
+  for (; i + length - 1 + 16 <= size; i += 16) {
+    __m128i blockFirst = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i blockLast =
+        _mm_loadu_si128((const __m128i *)(data + i + length - 1));
+    unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)));
+    while (mask != 0) {
+      unsigned bit = __builtin_ctz(mask);
+      if (std::memcmp(data + i + bit + 1, needle + 1, length - 2) == 0)
+        return i + bit;
+      mask &= mask - 1;
+    }
+  }
+  size_t rest = findScalar(data + i, size - i, needle, length);
+  return rest == Scanner::npos ? rest : i + rest;
+}
+
+__attribute__((target("sse2"))) size_t findByteSse2(const char *data,
+                                                    size_t size, char byte) {
+  const __m128i wanted = _mm_set1_epi8(byte);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, wanted));
+    if (mask != 0)
+      return i + __builtin_ctz(mask);
+  }
+  size_t rest = findByteScalar(data + i, size - i, byte);
+  return rest == Scanner::npos ? rest : i + rest;
+}
+
+// Unsigned c <= limit is min(c, limit) == c
+__attribute__((target("sse2"))) size_t findBelowSse2(const char *data,
+                                                     size_t size, char limit) {
+  const __m128i max = _mm_set1_epi8(limit);
+  const __m128i del = _mm_set1_epi8(0x7f);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i hit = _mm_or_si128(
+        _mm_cmpeq_epi8(_mm_min_epu8(block, max), block),
+        _mm_cmpeq_epi8(block, del));
+    unsigned mask = _mm_movemask_epi8(hit);
+    if (mask != 0)
+      return i + __builtin_ctz(mask);
+  }
+  size_t rest = limit == 0x1f ? findControlScalar(data + i, size - i)
+                              : findDelimiterScalar(data + i, size - i);
+  return rest == Scanner::npos ? rest : i + rest;
+}
+
+__attribute__((target("sse2"))) size_t findControlSse2(const char *data,
+                                                       size_t size) {
+  return findBelowSse2(data, size, 0x1f);
+}
+
+__attribute__((target("sse2"))) size_t findDelimiterSse2(const char *data,
+                                                         size_t size) {
+  return findBelowSse2(data, size, 0x20);
+}
+
+// low <= c <= high is (c - low) <= (high - low) unsigned
+__attribute__((target("sse2"))) inline __m128i inRangeSse2(__m128i block,
+                                                           char low,
+                                                           char high) {
+  __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8(low));
+  __m128i span = _mm_set1_epi8(static_cast<char>(high - low));
+  return _mm_cmpeq_epi8(_mm_min_epu8(shifted, span), shifted);
+}
+
+__attribute__((target("sse2"))) bool isUrlSafeSse2(const char *data,
+                                                   size_t size) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i ok = _mm_or_si128(
+        _mm_or_si128(inRangeSse2(block, 'a', 'z'), inRangeSse2(block, 'A', 'Z')),
+        _mm_or_si128(inRangeSse2(block, '-', '9'),
+                     _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('_')),
+                                  _mm_cmpeq_epi8(block, _mm_set1_epi8('~')))));
+    if (_mm_movemask_epi8(ok) != 0xffff)
+      return false;
+  }
+  return isUrlSafeScalar(data + i, size - i);
+}
+
+/* ------------------------------------------------------------------ AVX2 */
+
+__attribute__((target("avx2"))) size_t findAvx2(const char *data, size_t size,
+                                                const char *needle,
+                                                size_t length) {
+  if (length < 2 || length > size)
+    return findScalar(data, size, needle, length);
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[length - 1]);
+  size_t i = 0;
+  for (; i + length - 1 + 32 <= size; i += 32) {
+    __m256i blockFirst = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i blockLast =
+        _mm256_loadu_si256((const __m256i *)(data + i + length - 1));
+    unsigned mask = _mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst),
+                         _mm256_cmpeq_epi8(last, blockLast)));
+    while (mask != 0) {
+      unsigned bit = __builtin_ctz(mask);
+      if (std::memcmp(data + i + bit + 1, needle + 1, length - 2) == 0)
+        return i + bit;
+      mask &= mask - 1;
+    }
+  }
+  // The tail runs legacy SSE code, which stalls on dirty upper halves of
+  // the ymm registers until they are cleared
+  _mm256_zeroupper();
+  size_t rest = findSse2(data + i, size - i, needle, length);
+  return rest == Scanner::npos ? rest : i + rest;
+}
+
+__attribute__((target("avx2"))) size_t findByteAvx2(const char *data,
+                                                    size_t size, char byte) {
+  const __m256i wanted = _mm256_set1_epi8(byte);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+    unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wanted));
+    if (mask != 0)
+      return i + __builtin_ctz(mask);
+  }
+  _mm256_zeroupper();
+  size_t rest = findByteSse2(data + i, size - i, byte);
+  return rest == Scanner::npos ? rest : i + rest;
+}
+
+__attribute__((target("avx2"))) size_t findBelowAvx2(const char *data,
+                                                     size_t size, char limit) {
+  const __m256i max = _mm256_set1_epi8(limit);
+  const __m256i del = _mm256_set1_epi8(0x7f);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i hit = _mm256_or_si256(
+        _mm256_cmpeq_epi8(_mm256_min_epu8(block, max), block),
+        _mm256_cmpeq_epi8(block, del));
+    unsigned mask = _mm256_movemask_epi8(hit);
+    if (mask != 0)
+      return i + __builtin_ctz(mask);
+  }
+  _mm256_zeroupper();
+  size_t rest = findBelowSse2(data + i, size - i, limit);
+  return rest == Scanner::npos ? rest : i + rest;
+}
+
+__attribute__((target("avx2"))) size_t findControlAvx2(const char *data,
+                                                       size_t size) {
+  return findBelowAvx2(data, size, 0x1f);
+}
+
+__attribute__((target("avx2"))) size_t findDelimiterAvx2(const char *data,
+                                                         size_t size) {
+  return findBelowAvx2(data, size, 0x20);
+}
+
+__attribute__((target("avx2"))) inline __m256i inRangeAvx2(__m256i block,
+                                                           char low,
+                                                           char high) {
+  __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8(low));
+  __m256i span = _mm256_set1_epi8(static_cast<char>(high - low));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, span), shifted);
+}
+
+__attribute__((target("avx2"))) bool isUrlSafeAvx2(const char *data,
+                                                   size_t size) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+    __m256i ok = _mm256_or_si256(
+        _mm256_or_si256(inRangeAvx2(block, 'a', 'z'),
+                        inRangeAvx2(block, 'A', 'Z')),
+        _mm256_or_si256(
+            inRangeAvx2(block, '-', '9'),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('_')),
+                            _mm256_cmpeq_epi8(block, _mm256_set1_epi8('~')))));
+    if (static_cast<unsigned>(_mm256_movemask_epi8(ok)) != 0xffffffffu)
+      return false;
+  }
+  _mm256_zeroupper();
+  return isUrlSafeSse2(data + i, size - i);
+}
+
+#endif // SCANNER_X86
+
+// Kernels of one instruction set, false if the CPU does not have it
+bool kernelsFor(std::string_view isa, Kernels &kernels) {
+#ifdef SCANNER_X86
+  __builtin_cpu_init();
+  if (isa == "avx2" && __builtin_cpu_supports("avx2")) {
+    kernels = {findAvx2, findByteAvx2, findControlAvx2, findDelimiterAvx2,
+               isUrlSafeAvx2, "avx2"};
+    return true;
+  }
+  if (isa == "sse2" && __builtin_cpu_supports("sse2")) {
+    kernels = {findSse2, findByteSse2, findControlSse2, findDelimiterSse2,
+               isUrlSafeSse2, "sse2"};
+    return true;
+  }
+#endif
+  if (isa == "scalar") {
+    kernels = {findScalar, findByteScalar, findControlScalar,
+               findDelimiterScalar, isUrlSafeScalar, "scalar"};
+    return true;
+  }
+  return false;
+}
+
+Kernels selectKernels() {
+  Kernels kernels;
+  if (kernelsFor("avx2", kernels) == false &&
+      kernelsFor("sse2", kernels) == false)
+    kernelsFor("scalar", kernels);
+  return kernels;
+}
+
+// Chosen on first use, the static is initialised once across threads
+Kernels &kernels() {
+  static Kernels selected = selectKernels();
+  return selected;
+}
+
+} // namespace
+
+size_t Scanner::find(std::string_view haystack, std::string_view needle,
+                     size_t from) {
+  if (from > haystack.size())
+    return npos;
+  size_t found = kernels().find(haystack.data() + from, haystack.size() - from,
+                                needle.data(), needle.size());
+  return found == npos ? npos : from + found;
+}
+
+size_t Scanner::findByte(std::string_view data, char byte, size_t from) {
+  if (from >= data.size())
+    return npos;
+  size_t found = kernels().findByte(data.data() + from, data.size() - from,
+                                    byte);
+  return found == npos ? npos : from + found;
+}
+
+size_t Scanner::findControl(std::string_view data, size_t from) {
+  if (from >= data.size())
+    return npos;
+  size_t found = kernels().findControl(data.data() + from, data.size() - from);
+  return found == npos ? npos : from + found;
+}
+
+size_t Scanner::findDelimiter(std::string_view data, size_t from) {
+  if (from >= data.size())
+    return npos;
+  size_t found =
+      kernels().findDelimiter(data.data() + from, data.size() - from);
+  return found == npos ? npos : from + found;
+}
+
+bool Scanner::isUrlSafe(std::string_view data) {
+  return kernels().isUrlSafe(data.data(), data.size());
+}
+
+const char *Scanner::isa() { return kernels().isa; }
+
+bool Scanner::useIsa(const char *isa) { return kernelsFor(isa, kernels()); }
@@ -0,0 +1,33 @@
+#ifndef SCANNER_HPP
+#define SCANNER_HPP
+
+#include <cstddef>
+#include <string_view>
+
+// Vectorised byte scans for the request and body parsers. Every kernel has
+// a scalar, an SSE2 and an AVX2 version; the widest one the CPU supports is
+// picked once at runtime. Results match the scalar version byte for byte.
+class Scanner {
+	public:
+	static const size_t npos = std::string_view::npos;
+
+	// First occurrence of needle, npos if there is none
+	static size_t find(std::string_view haystack, std::string_view needle,
+	                   size_t from = 0);
+	// First occurrence of byte, npos if there is none
+	static size_t findByte(std::string_view data, char byte, size_t from = 0);
+	// First control byte (below 0x20 or DEL), npos if there is none
+	static size_t findControl(std::string_view data, size_t from = 0);
+	// First control byte or space, the end of a request line token
+	static size_t findDelimiter(std::string_view data, size_t from = 0);
+	// True if every byte is alphanumeric or one of - _ . ~ /
+	static bool isUrlSafe(std::string_view data);
+
+	// "avx2", "sse2" or "scalar"
+	static const char *isa();
+	// Switches every kernel to isa, false if the CPU lacks it. For the
+	// benchmarks, a running server keeps what was picked at startup.
+	static bool useIsa(const char *isa);
+};
+
+#endif // SCANNER_HPP
@@ -2,11 +2,28 @@
 #include "HttpRequest.hpp"
 
 volatile sig_atomic_t gServerSignal = 1;
+volatile sig_atomic_t gStopSignal = 0;
+// Written from the signal handler to wake every event loop, not only the
+// thread that happened to receive the signal
+static int gShutdownPipe[2] = {-1, -1};
+
+static const int cgiPollMs = 10;
+static const int maxAcceptsPerWakeup = 64;
+static const size_t maxPipelinedOutput = 1024 * 1024;
+// Bounds on draining a client after an early answer before closing anyway
+static const int lingerMs = 2000;
+static const size_t maxLingerBytes = 1024 * 1024;
 
 // Constructor
 
-SocketManager::SocketManager(std::vector<ServerParser> parser)
-    : servers(parser) {
+SocketManager::SocketManager(std::vector<ServerParser> parser,
+                             const HttpConfig &http)
+    : servers(parser), files(http.mmap_threshold), http(http), backend(NULL),
+      nextConnectionId(0) {
+  reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  inherited = servers.empty() == false && servers.front().sockfd != -1;
+  backend = EventBackend::create(http.event_backend);
+  INFO("Using " << backend->name() << " event backend");
   createServerSockets();
   pollingAndConnections();
 }
@@ -14,11 +31,20 @@ SocketManager::SocketManager(std::vector<ServerParser> parser)
 // Destructor
 
 SocketManager::~SocketManager() {
-  std::vector<struct pollfd>::iterator itp;
-  for (itp = pollFds.begin(); itp != pollFds.end(); itp++) {
-    INFO("Closing all open socket fds: " << itp->fd);
-    close(itp->fd);
+  for (int fd = 0; fd < clients.end(); fd++) {
+    if (clients.typeOf(fd) != FD_UNUSED) {
+      INFO("Closing all open socket fds: " << fd);
+      close(fd);
+    }
   }
+  if (reserveFd != -1)
+    close(reserveFd);
+  unsigned long lookups = files.hits() + files.misses();
+  if (lookups > 0)
+    INFO("File cache: " << files.hits() << " hits, " << files.misses()
+                        << " misses (" << files.hits() * 100 / lookups
+                        << "% hit ratio)");
+  delete backend;
 }
 
 // Getters
@@ -27,19 +53,86 @@ std::vector<ServerParser> SocketManager::getServers() const { return servers; }
 
 // Signal function
 
-void stopServerLoop(int) {
+void stopServerLoop(int signum) {
   gServerSignal = 0;
+  gStopSignal = signum;
+  if (gShutdownPipe[1] != -1) {
+    ssize_t ret = write(gShutdownPipe[1], "", 1);
+    (void)ret;
+  }
   INFO("CTRL + C signal recieved, stopping Server");
 }
 
+// No SA_RESTART so a blocking waitpid in the master returns with EINTR
+void SocketManager::setupSignals() {
+  if (gShutdownPipe[0] == -1 && pipe(gShutdownPipe) == 0) {
+    fcntl(gShutdownPipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(gShutdownPipe[1], F_SETFL, O_NONBLOCK);
+    fcntl(gShutdownPipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(gShutdownPipe[1], F_SETFD, FD_CLOEXEC);
+  }
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = stopServerLoop;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+}
+
+// A forked worker must not share the master's pipe, a byte written by the
+// master would otherwise wake the worker without stopping it
+void SocketManager::resetSignals() {
+  if (gShutdownPipe[0] != -1) {
+    close(gShutdownPipe[0]);
+    close(gShutdownPipe[1]);
+    gShutdownPipe[0] = -1;
+    gShutdownPipe[1] = -1;
+  }
+  gServerSignal = 1;
+  gStopSignal = 0;
+  setupSignals();
+}
+
 // Create Sockets Fds and Poll fds
 
 void SocketManager::createServerSockets() {
   INFO("Booting servers ... ");
-  std::vector<int> ports;
+  bindListeners(servers, http.workers > 1 && http.worker_mode == "thread");
+
+  std::vector<ServerParser>::iterator it;
+  for (it = servers.begin(); it != servers.end(); it++) {
+    if (clients.isListener(it->sockfd) == true)
+      continue;
+    // Listeners bound by a master process are shared with sibling workers
+    if (inherited == true)
+      backend->addShared(it->sockfd);
+    else
+      backend->addListener(it->sockfd);
+    clients.addListener(it->sockfd);
+  }
+  vhosts.build(servers);
+}
+
+// Server blocks that were already bound, by a master process, keep their fd
+void SocketManager::bindListeners(std::vector<ServerParser> &servers,
+                                  bool reusePort) {
   std::vector<ServerParser>::iterator it;
 
   for (it = servers.begin(); it != servers.end(); it++) {
+    if (it->sockfd != -1)
+      continue;
+    // Server blocks sharing a port share the first block's listener
+    std::vector<ServerParser>::iterator bound;
+    for (bound = servers.begin(); bound != it; bound++) {
+      if (bound->listen == it->listen)
+        break;
+    }
+    if (bound != it) {
+      it->sockfd = bound->sockfd;
+      continue;
+    }
+
     it->sockfd = socket(AF_INET, SOCK_STREAM, 0);
 
     if (it->sockfd == -1)
@@ -49,6 +142,11 @@ void SocketManager::createServerSockets() {
     if (setsockopt(it->sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) <
         0)
       throw std::runtime_error("setsockopt(SO_REUSEADDR) failed");
+    // Every worker thread binds its own listener, the kernel spreads
+    // incoming connections across them
+    if (reusePort && setsockopt(it->sockfd, SOL_SOCKET, SO_REUSEPORT, &enable,
+                                sizeof(int)) < 0)
+      throw std::runtime_error("setsockopt(SO_REUSEPORT) failed");
 
     if (fcntl(it->sockfd, F_SETFL, O_NONBLOCK) < 0)
       throw std::runtime_error("Failed to make server socket non blocking: " +
@@ -60,216 +158,371 @@ void SocketManager::createServerSockets() {
     serverAddress.sin_port = htons(it->listen);
     serverAddress.sin_addr.s_addr = INADDR_ANY;
 
-    if (std::find(ports.begin(), ports.end(), it->listen) == ports.end()) {
-      if (bind(it->sockfd, (struct sockaddr *)&serverAddress,
-               sizeof(serverAddress)) < 0)
-        throw std::runtime_error("Failed to bind socket to address: " +
-                                 std::string(strerror(errno)));
-
-      if (listen(it->sockfd, SOMAXCONN) < 0)
-        throw std::runtime_error("Failed to listen on socket: " +
-                                 std::string(strerror(errno)));
-
-      struct pollfd pollfd;
-
-      pollfd.fd = it->sockfd;
-      pollfd.events = POLLIN;
-      pollfd.revents = 0;
+    if (bind(it->sockfd, (struct sockaddr *)&serverAddress,
+             sizeof(serverAddress)) < 0)
+      throw std::runtime_error("Failed to bind socket to address: " +
+                               std::string(strerror(errno)));
 
-      pollFds.push_back(pollfd);
-      serverSocketsFds.push_back(it->sockfd);
-      ports.push_back(it->listen);
-    }
+    if (listen(it->sockfd, SOMAXCONN) < 0)
+      throw std::runtime_error("Failed to listen on socket: " +
+                               std::string(strerror(errno)));
   }
 }
 
 // Polling and Connections
 
+// Drains the backlog in one wakeup, capped so a connection burst cannot
+// starve clients that are already connected. Accept failures never stop the
+// server loop.
 void SocketManager::acceptConnection(int &pollFd) {
-  struct sockaddr_in clientAddress;
-  socklen_t clientAddressLen = sizeof(clientAddress);
-  int clientSocket =
-      accept(pollFd, (struct sockaddr *)&clientAddress, &clientAddressLen);
-  if (clientSocket < 0)
-    throw std::runtime_error("Failed to accept client connection: " +
-                             std::string(strerror(errno)));
-  if (fcntl(clientSocket, F_SETFL, O_NONBLOCK) < 0)
-    throw std::runtime_error("Failed to make client socket non blocking: " +
-                             std::string(strerror(errno)));
-  struct pollfd clientPollFd = {clientSocket, POLLIN, 0};
-  pollFds.push_back(clientPollFd);
-  clientSocketsFds.push_back(clientSocket);
-  clientState client = (struct clientState){};
-  clients[clientSocket] = client;
-
-  clients[clientSocket].clear();
-  clients[clientSocket].socketFd = clientSocket;
-  std::time(&clients[clientSocket].lastEventTime);
-  SUCCESS("Accepted new client connection: " << clientSocket);
-}
-
-bool SocketManager::isServerFd(int pollFd) {
-  if (std::find(serverSocketsFds.begin(), serverSocketsFds.end(), pollFd) !=
-      serverSocketsFds.end())
-    return true;
-  return false;
+  for (int accepted = 0; accepted < maxAcceptsPerWakeup; accepted++) {
+    int clientSocket = backend->accept(pollFd);
+    if (clientSocket < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        pendingAccepts.erase(pollFd);
+        return;
+      }
+      if (errno == ECONNABORTED || errno == EINTR || errno == EPROTO)
+        continue;
+      if (errno == EMFILE || errno == ENFILE) {
+        rejectConnection(pollFd);
+        continue;
+      }
+      WARNING("Failed to accept client connection: " << strerror(errno));
+      pendingAccepts.erase(pollFd);
+      return;
+    }
+    backend->addConnection(clientSocket);
+    clientState &client = clients.addClient(clientSocket);
+
+    client.clear();
+    client.interest = POLLIN;
+    client.socketFd = clientSocket;
+    client.listenFd = pollFd;
+    client.readBuffer.attach(&buffers);
+    client.serverData = vhosts.defaultServer(pollFd);
+    client.connectionId = ++nextConnectionId;
+    touch(client);
+    SUCCESS("Accepted new client connection: " << clientSocket);
+  }
+  // An edge triggered listener will not report the rest of the backlog again
+  if (backend->isEdgeTriggered() == true)
+    pendingAccepts.insert(pollFd);
 }
 
-bool SocketManager::isClientFd(int pollFd) {
-  if (std::find(clientSocketsFds.begin(), clientSocketsFds.end(), pollFd) !=
-      clientSocketsFds.end())
-    return true;
-  return false;
+// Out of descriptors: free the reserved one to accept and close the pending
+// connection, otherwise it stays queued and the listener keeps firing
+void SocketManager::rejectConnection(int listenFd) {
+  if (reserveFd == -1) {
+    pendingAccepts.erase(listenFd);
+    return;
+  }
+  close(reserveFd);
+  int clientSocket = accept(listenFd, NULL, NULL);
+  if (clientSocket >= 0) {
+    WARNING("Out of file descriptors, rejected connection on: " << listenFd);
+    close(clientSocket);
+  } else {
+    pendingAccepts.erase(listenFd);
+  }
+  reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
 }
 
 void SocketManager::pollin(pollfd &pollFd) {
-  if (isServerFd(pollFd.fd) == true) {
+  if (clients.isListener(pollFd.fd) == true) {
     acceptConnection(pollFd.fd);
-  } else {
-    char buffer[4096 * 4];
-    std::memset(&buffer[0], 0, sizeof(buffer));
-    ssize_t bytesRead = recv(pollFd.fd, buffer, sizeof(buffer), 0);
+    return;
+  }
+  // Edge triggered backends only notify once, keep reading until the socket
+  // is drained or responses are waiting to be written
+  clientState &client = clients[pollFd.fd];
+  ReadBuffer &input = client.readBuffer;
+  do {
+    // A head that outgrew the largest buffer is answered, its rest drained
+    if (input.reserve() == false) {
+      WARNING("Request header too large on socket: " << pollFd.fd);
+      client.requestError = 431;
+      HttpRequest::rejectRequest(client);
+      processRequests(client);
+      break;
+    }
+    ssize_t bytesRead =
+        backend->receive(pollFd.fd, input.tail(), input.space());
     if (bytesRead == 0) {
+      client.closeConnection = true;
       return;
     } else if (bytesRead == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
       WARNING("No data available to read on socket: " << pollFd.fd);
-      clients[pollFd.fd].closeConnection = true;
+      client.closeConnection = true;
       return;
     }
 
-    clients[pollFd.fd].bytesRead = bytesRead;
-    clients[pollFd.fd].readString = std::string(buffer, bytesRead);
+    client.bytesRead = bytesRead;
+    input.produced(bytesRead);
+    if (client.lastRequest == true && client.discardBody > 0) {
+      discardInput(client);
+      continue;
+    }
+    touch(client);
+    processRequests(client);
+  } while (client.output.empty() == true && client.isForked == false &&
+           (client.lastRequest == false || client.lingering == true) &&
+           client.closeConnection == false && backend->isEdgeTriggered());
+
+  input.shrink();
+  updateInterest(client);
+}
 
-    HttpRequest::requestBlock(clients[pollFd.fd], servers);
-    std::time(&clients[pollFd.fd].lastEventTime);
-    HttpResponse response;
-    switch (clients[pollFd.fd].method) {
-    case DEFAULT:
-      break;
-    case POST:
-      if (clients[pollFd.fd].flagHeaderRead == true &&
-          clients[pollFd.fd].flagBodyRead == true) { 
-        clients[pollFd.fd].writeString = response.respond(clients[pollFd.fd]);
-        pollFd.events = POLLOUT;
-      }
-      break;
-    default:
-      if (clients[pollFd.fd].flagHeaderRead == true) {
-        clients[pollFd.fd].writeString = response.respond(clients[pollFd.fd]);
-        pollFd.events = POLLOUT;
-      }
-      break;
+// Answers the complete requests in the read buffer in order, so pipelined
+// requests get their responses queued back to back. Stops at an incomplete
+// request, a running CGI, a request that ends the connection, or once enough
+// output is queued that the socket should catch up first.
+void SocketManager::processRequests(clientState &client) {
+  while (client.lastRequest == false && client.isForked == false &&
+         client.output.size() < maxPipelinedOutput) {
+    HttpRequest::requestBlock(client, vhosts);
+    if (HttpRequest::isComplete(client) == false)
+      return;
+    HttpResponse response(files);
+    response.respond(client);
+    // A forked CGI is polled from the event loop until its output is ready
+    if (client.isForked == true) {
+      cgiClients.insert(client.socketFd);
+      armTimer(client, TimerQueue::now() +
+                           client.serverData->send_timeout * 1000LL);
+      return;
     }
+    finishRequest(client);
   }
 }
 
+void SocketManager::finishRequest(clientState &client) {
+  if (client.isKeepAlive == false)
+    client.lastRequest = true;
+  client.nextRequest();
+}
 
-void SocketManager::pollout(pollfd &pollFd) {
-	HttpResponse response;
+// POLLOUT while responses are queued, nothing while a CGI runs, else POLLIN
+void SocketManager::updateInterest(clientState &client) {
+  short events = POLLIN;
+  if (client.output.empty() == false)
+    events = POLLOUT;
+  else if (client.isForked == true)
+    events = 0;
+  if (events == client.interest)
+    return;
+  backend->modify(client.socketFd, events);
+  client.interest = events;
+}
 
-	if (clients[pollFd.fd].isForked == true) {
-		clients[pollFd.fd].writeString = response.respond(clients[pollFd.fd]);
-		return ;
-	}
+// Drops what arrived for a request that was answered before its body was
+// read; once the lingering budget is spent the connection closes
+void SocketManager::discardInput(clientState &client) {
+  size_t dropped = client.readBuffer.size();
+  client.readBuffer.consume(dropped);
+  if (dropped < client.discardBody) {
+    client.discardBody -= dropped;
+    return;
+  }
+  client.discardBody = 0;
+  if (client.lingering == true)
+    client.closeConnection = true;
+}
 
-  if (clients[pollFd.fd].writeString.empty() == true) {
+// The client may still be sending a body nobody reads. Closing with unread
+// input resets the connection and can destroy the answer before the client
+// reads it, so the write side is shut and input drained for a bounded time
+// and size instead.
+void SocketManager::linger(clientState &client) {
+  shutdown(client.socketFd, SHUT_WR);
+  client.lingering = true;
+  client.discardBody = std::min(client.discardBody, maxLingerBytes);
+  armTimer(client, TimerQueue::now() + lingerMs);
+  updateInterest(client);
+}
+
+void SocketManager::pollout(pollfd &pollFd) {
+  clientState &client = clients[pollFd.fd];
+  if (client.output.empty() == true) {
     WARNING("Response buffer Empty on socket: " << pollFd.fd);
-    clients[pollFd.fd].clear();
-    pollFd.events = POLLIN;
+    updateInterest(client);
     return;
   }
 
-	ssize_t bytesSend = send(pollFd.fd, clients[pollFd.fd].writeString.c_str(),
-														clients[pollFd.fd].writeString.size(), 0);
+  // Nothing follows the last response unless the input is drained first
+  bool closeAfter = client.lastRequest == true && client.discardBody == 0;
+  while (client.output.empty() == false) {
+    ssize_t bytesSend = backend->send(pollFd.fd, client.output, closeAfter);
 
-  if (bytesSend == 0) {
-    WARNING("Empty response sent on socket: " << pollFd.fd);
-    return;
-  } else if (bytesSend == -1) {
-		ERROR("Failed to send a response on socket: " << pollFd.fd);
-		clients[pollFd.fd].closeConnection = true;
-    return ;
+    if (bytesSend == 0) {
+      // A file shrank after its Content-Length was sent
+      WARNING("Empty response sent on socket: " << pollFd.fd);
+      client.closeConnection = true;
+      return;
+    } else if (bytesSend == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return;
+      ERROR("Failed to send a response on socket: " << pollFd.fd);
+      client.closeConnection = true;
+      return;
+    }
+
+    touch(client);
+    if (backend->isEdgeTriggered() == false)
+      break;
   }
 
-  std::time(&clients[pollFd.fd].lastEventTime);
-  clients[pollFd.fd].writeString.erase(0, bytesSend);
-  if (clients[pollFd.fd].writeString.empty() == true) {
+  if (client.output.empty() == true) {
     SUCCESS("Response sent successfully on socket: " << pollFd.fd);
-    if (clients[pollFd.fd].isKeepAlive == false) {
-      clients[pollFd.fd].closeConnection = true;
+    if (client.lastRequest == true) {
+      if (client.discardBody == 0)
+        client.closeConnection = true;
+      else
+        linger(client);
+      return;
     }
-    pollFd.events = POLLIN;
-    clients[pollFd.fd].clear();
+    // Pipelined requests that arrived with the ones just answered
+    processRequests(client);
+    client.readBuffer.shrink();
+    updateInterest(client);
   }
 }
 
-bool SocketManager::checkAndCloseStaleConnections(struct pollfd &pollFd) {
-  if (clients[pollFd.fd].serverData.server_name.empty() == true) {
-    return false;
+void SocketManager::pollCgi() {
+  HttpResponse response(files);
+  std::set<int>::iterator it = cgiClients.begin();
+
+  while (it != cgiClients.end()) {
+    clientState &client = clients[*it];
+    response.respond(client);
+    if (client.isForked == true) {
+      ++it;
+      continue;
+    }
+    touch(client);
+    cgiClients.erase(it++);
+    finishRequest(client);
+    processRequests(client);
+    updateInterest(client);
   }
+}
 
-  time_t currentTime = 0;
-  std::time(&currentTime);
-  if ((clients[pollFd.fd].closeConnection == true) ||
-      std::difftime(currentTime, clients[pollFd.fd].lastEventTime) > clients[pollFd.fd].serverData.keepalive_timeout) {
+void SocketManager::closeClientConnection(int pollFd) {
+  INFO("Closing client connection on fd: " << pollFd);
 
-    INFO("Closing client connection on fd: " << pollFd.fd);
+  int closed = backend->close(pollFd, clients[pollFd].output);
+  clients.remove(pollFd);
+  if (closed == -1)
+    throw std::runtime_error("Failed to close client connection!");
+}
 
-    if (close(pollFd.fd) == -1)
-      throw std::runtime_error("Failed to close client connection!");
+// Timers
 
-    auto removeFd = [pollFd](std::vector<int> &fds) {
-      auto it = std::find(fds.begin(), fds.end(), pollFd.fd);
-      if (it != fds.end()) {
-        fds.erase(it);
-      }
-    };
+// Only queues a new entry when the deadline moves earlier than the armed one,
+// later deadlines are picked up lazily when the armed entry pops
+void SocketManager::armTimer(clientState &client, long long deadline) {
+  client.deadline = deadline;
+  if (client.timerArmed == 0 || deadline < client.timerArmed) {
+    timers.schedule(client.socketFd, client.connectionId, deadline);
+    client.timerArmed = deadline;
+  }
+}
 
-    removeFd(clientSocketsFds);
-    removeFd(serverSocketsFds);
-    clients.erase(pollFd.fd);
+void SocketManager::touch(clientState &client) {
+  armTimer(client, TimerQueue::now() + keepaliveTimeout(client) * 1000LL);
+}
 
-    std::vector<struct pollfd>::iterator it;
-    for (it = pollFds.begin(); it != pollFds.end(); it++) {
-      if (it->fd == pollFd.fd) {
-        pollFds.erase(it);
-        break;
-      }
+// Before a request picked a server block the listener's default server applies
+int SocketManager::keepaliveTimeout(const clientState &client) {
+  return client.serverData->keepalive_timeout;
+}
+
+void SocketManager::expireTimers() {
+  std::vector<TimerQueue::Timer> expired;
+  long long now = TimerQueue::now();
+
+  timers.popExpired(now, expired);
+  for (size_t i = 0; i < expired.size(); i++) {
+    clientState *found = clients.find(expired[i].fd);
+    if (found == NULL || found->connectionId != expired[i].id ||
+        found->timerArmed != expired[i].deadline)
+      continue;
+
+    clientState &client = *found;
+    client.timerArmed = 0;
+    if (client.deadline > now) {
+      armTimer(client, client.deadline);
+    } else if (client.isForked == true) {
+      // parentProcess sees the passed deadline and answers 504
+      pollCgi();
+    } else {
+      INFO("Keepalive timeout on fd: " << client.socketFd);
+      closeClientConnection(client.socketFd);
     }
-    return true;
   }
-  return false;
+}
+
+void SocketManager::handleEvent(pollfd &pollFd) {
+  fdType type = clients.typeOf(pollFd.fd);
+  if (type == FD_UNUSED) // shutdown pipe
+    return;
+
+  if (pollFd.revents & POLLIN) {
+    pollin(pollFd);
+  }
+
+  if (type != FD_CLIENT)
+    return;
+
+  if (pollFd.revents & (POLLHUP | POLLERR | POLLNVAL)) {
+    clients[pollFd.fd].closeConnection = true;
+  } else if (pollFd.revents & POLLOUT) {
+    pollout(pollFd);
+  }
+
+  if (!clients[pollFd.fd].isForked && clients[pollFd.fd].closeConnection)
+    closeClientConnection(pollFd.fd);
 }
 
 void SocketManager::pollingAndConnections() {
   if (servers.size() < 1)
     return;
 
-  signal(SIGPIPE, SIG_IGN);
-  signal(SIGINT, stopServerLoop);
+  setupSignals();
+  backend->add(gShutdownPipe[0], POLLIN);
 
+  std::vector<struct pollfd> ready;
   while (gServerSignal) {
-    if (poll(&pollFds[0], pollFds.size(), 0) == -1 && gServerSignal == 1) {
-      throw std::runtime_error("Error from poll function");
+    // Sleep until a fd is ready or the next deadline, a running CGI is
+    // reaped with waitpid so it is checked on a short interval instead
+    int timeout = timers.nextTimeout(TimerQueue::now());
+    if (cgiClients.empty() == false && (timeout == -1 || timeout > cgiPollMs))
+      timeout = cgiPollMs;
+    if (pendingAccepts.empty() == false)
+      timeout = 0;
+
+    if (backend->wait(ready, timeout) == -1 && gServerSignal == 1) {
+      throw std::runtime_error("Error from " + std::string(backend->name()) +
+                               " function");
     }
 
-    for (size_t i = 0; i < pollFds.size(); i++) {
-      if (pollFds[i].revents & POLLIN) {
-        pollin(pollFds[i]);
-      }
-
-      if (pollFds[i].revents & (POLLHUP | POLLERR | POLLNVAL)) {
-        clients[pollFds[i].fd].closeConnection = true;
-      }
-
-      if (isClientFd(pollFds[i].fd) == true) {
-        if (pollFds[i].revents & POLLOUT) {
-          pollout(pollFds[i]);
-        }
-        if (!clients[pollFds[i].fd].isForked && checkAndCloseStaleConnections(pollFds[i]))
-            i--;
-      }
+    // Listeners that hit the accept cap last pass get their turn after the
+    // clients that were ready
+    std::set<int> backlog(pendingAccepts);
+    for (size_t i = 0; i < ready.size(); i++) {
+      handleEvent(ready[i]);
+    }
+    std::set<int>::iterator it;
+    for (it = backlog.begin(); it != backlog.end(); it++) {
+      int listenFd = *it;
+      if (pendingAccepts.count(listenFd) != 0)
+        acceptConnection(listenFd);
     }
+    if (cgiClients.empty() == false)
+      pollCgi();
+    expireTimers();
   }
 }
 
@@ -280,7 +533,7 @@ std::ostream &operator<<(std::ostream &output, const clientState &clientState) {
          << "\nBody Read Flag: " << clientState.flagBodyRead
          << "\nbytes read: " << clientState.bytesRead
          << "\ncontent Length: " << clientState.contentLength
-         << "\nstart time: " << clientState.lastEventTime
+         << "\ndeadline: " << clientState.deadline
          << "\nbody: " << clientState.bodyString << std::endl;
 
   return output;
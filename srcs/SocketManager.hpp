@@ -1,15 +1,19 @@
 #ifndef SOCKET_MANAGER_HPP
 #define SOCKET_MANAGER_HPP
 
+#include "ConnectionTable.hpp"
+#include "EventBackend.hpp"
+#include "FileCache.hpp"
 #include "HttpResponse.hpp"
 #include "Structs.hpp"
 #include "Parser.hpp"
+#include "TimerQueue.hpp"
+#include "VhostIndex.hpp"
 #include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <poll.h>
-#include <regex>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -17,38 +21,56 @@
 
 class SocketManager {
 	private:
-	std::vector<int> serverSocketsFds;
-	std::vector<int> clientSocketsFds;
 	std::vector<ServerParser> servers;
-	std::vector<struct pollfd> pollFds;
-	std::map<int, clientState> clients;
+	BufferPool buffers; // declared first, client read buffers return to it
+	FileCache files;    // static files served from memory or mappings
+	ConnectionTable clients;
+	VhostIndex vhosts;
+	std::set<int> cgiClients;
+	std::set<int> pendingAccepts; // listeners left with a non empty backlog
+	int reserveFd;                // spare fd released on EMFILE
+	HttpConfig http;
+	EventBackend *backend;
+	bool inherited;
+	TimerQueue timers;
+	unsigned long nextConnectionId;
 
 	public:
-	// typedefs
-	typedef std::vector<struct pollfd>::iterator pollFdsIterator;
-
-	SocketManager(std::vector<ServerParser> parser);
+	SocketManager(std::vector<ServerParser> parser, const HttpConfig &http);
 	~SocketManager();
 
 	// Getters
 	std::vector<ServerParser> getServers() const;
 
 	// other methods for socket manipulation
+	static void setupSignals();
+	static void resetSignals();
+	static void bindListeners(std::vector<ServerParser> &servers, bool reusePort);
 	void createServerSockets();
 	void pollingAndConnections();
 
-	// Bool return methods for checking if its client or server fd
-	bool isServerFd(int pollFd);
-	bool isClientFd(int pollFd);
-
+  void handleEvent(pollfd &pollFd);
   void pollin(pollfd &pollFd);
   void pollout(pollfd &pollFd);
+  void pollCgi();
+  void processRequests(clientState &client);
+  void finishRequest(clientState &client);
+  void updateInterest(clientState &client);
+  void discardInput(clientState &client);
+  void linger(clientState &client);
   void acceptConnection(int &pollFd);
-  void closeClientConnection(int &pollFd);
+  void rejectConnection(int listenFd);
+  void closeClientConnection(int pollFd);
   void assignServerBlock(int &pollFd);
-  bool checkAndCloseStaleConnections(struct pollfd &pollfd);
+  void armTimer(clientState &client, long long deadline);
+  void touch(clientState &client);
+  int keepaliveTimeout(const clientState &client);
+  void expireTimers();
 };
 
 std::ostream &operator<<(std::ostream &output, const clientState &clientState);
 
+extern volatile sig_atomic_t gServerSignal;
+extern volatile sig_atomic_t gStopSignal;
+
 #endif // SOCKET_MANAGER_HPP
\ No newline at end of file
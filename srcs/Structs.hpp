@@ -15,6 +15,12 @@
 #include <stack>
 #include <string>
 #include <vector>
+#include "BufferPool.hpp"
+#include "ChunkedDecoder.hpp"
+#include "HeaderTable.hpp"
+#include "MultipartUpload.hpp"
+#include "OutputQueue.hpp"
+#include "RequestParser.hpp"
 
 // Global mime type map
 extern std::map<std::string, std::string> g_mimeTypes;
@@ -34,10 +40,14 @@ enum token {
   LOCATION = 11,         // needed
   METHODS = 12,
   REDIRECT = 13,
-  OPEN_CURLY_BRACKET = 14,
-  CLOSED_CURLY_BRACKET = 15,
-  SEMICOLON = 16,
-  UNKNOWN = 17
+  EVENT_BACKEND = 14,    // http block, default
+  WORKERS = 15,          // http block, default
+  WORKER_MODE = 16,      // http block, default
+  MMAP_THRESHOLD = 17,   // http block, default
+  OPEN_CURLY_BRACKET = 18,
+  CLOSED_CURLY_BRACKET = 19,
+  SEMICOLON = 20,
+  UNKNOWN = 21
 };
 
 struct lexer_node {
@@ -85,6 +95,22 @@ struct ServerParser {
 	}
 };
 
+// Directives that live directly inside the http block
+struct HttpConfig {
+  std::string event_backend;
+  int workers;
+  std::string worker_mode;
+  size_t mmap_threshold; // files this large are mmap'ed, 0 leaves them to sendfile
+
+	void clear() {
+		event_backend.clear();
+		workers = 0;
+		worker_mode.clear();
+		mmap_threshold = 0;
+	}
+};
+
+enum fdType { FD_UNUSED = 0, FD_LISTENER = 1, FD_CLIENT = 2 };
 
 enum methods { GET = 1, POST = 2, DELETE = 3, CGI = 4, DEFAULT = -1};
 
@@ -95,48 +121,82 @@ struct clientState {
 	bool isKeepAlive;
 	bool closeConnection;
 	bool flagFileSizeTooBig;
-	bool flagFileStatus;
 	bool isForked;
+	bool isChunked;
+	int requestError; // status the request is rejected with, 0 if none
+	bool lastRequest; // no further request is read, close once output is sent
+	bool lingering;   // last response sent, write side shut, input drained
+	short interest;   // events the backend currently watches
 	methods method;
 	int socketFd;
+	int listenFd;
 	int	fd[2];
 	pid_t	pid;
 	ssize_t bytesRead;
 	ssize_t contentLength;
-	time_t lastEventTime;
+	size_t bodySize; // decoded body bytes received so far
+	size_t discardBody; // input of an answered request still to be dropped
+	unsigned long connectionId;
+	long long deadline;   // keepalive or CGI deadline, monotonic ms
+	long long timerArmed; // deadline of the queued timer entry, 0 if none
 	std::string bodyString;
+	std::string cgiOutput; // script output read so far
+	std::shared_ptr<OpenFile> bodyFile; // spooled body, the CGI's stdin
+	ChunkedDecoder chunked;
+	MultipartUpload upload; // form upload written to disk as it arrives
 	std::vector<char> body;
-	std::string readString;
-	std::string writeString;
+	ReadBuffer readBuffer;
+	RequestParser parser;
+	OutputQueue output;
 
 	std::vector<std::string> requestLine;
-	std::map<std::string, std::string> header;
-	ServerParser serverData;
+	std::string path;  // decoded and normalized target path
+	std::string query; // raw query string, without the '?'
+	HeaderTable headers;
+	const ServerParser *serverData; // shared, owned by the SocketManager
 	std::string	contentType;
-	std::string	boundary;
-	std::string	fileName;
 
-	void clear() {
+	// Per request state; buffered input and queued responses are kept so
+	// pipelined requests survive
+	void nextRequest() {
 	flagHeaderRead = false;
 	flagBodyRead = false;
 	flagPartiallyRead = false;
+	flagFileSizeTooBig = false;
 	isKeepAlive = false;
-	closeConnection = false;
 	isForked = false;
+	isChunked = false;
+	requestError = 0;
+	parser.reset();
+	chunked.reset();
+	upload.reset();
 	method = DEFAULT; // Or some default method
 	pid = -1;
 	bytesRead = -1;
 	contentLength = 0;
+	bodySize = 0;
 	bodyString.clear();
+	cgiOutput.clear();
+	bodyFile.reset();
 	body.clear();
-	readString.clear();
-	writeString.clear();
 	requestLine.clear();
-	header.clear();
+	path.clear();
+	query.clear();
+	headers.clear();
 	contentType.clear();
-	boundary.clear();
-	fileName.clear();
-}
+	}
+
+	void clear() {
+		nextRequest();
+		closeConnection = false;
+		lastRequest = false;
+		lingering = false;
+		discardBody = 0;
+		interest = 0;
+		deadline = 0;
+		timerArmed = 0;
+		output.clear();
+	}
 };
 
 #endif
\ No newline at end of file
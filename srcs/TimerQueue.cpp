@@ -0,0 +1,36 @@
+#include "TimerQueue.hpp"
+#include <chrono>
+
+TimerQueue::TimerQueue() {}
+
+TimerQueue::~TimerQueue() {}
+
+long long TimerQueue::now() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void TimerQueue::schedule(int fd, unsigned long id, long long deadline) {
+  Timer timer = {deadline, fd, id};
+  heap.push(timer);
+}
+
+int TimerQueue::nextTimeout(long long now) const {
+  if (heap.empty() == true)
+    return -1;
+  long long delta = heap.top().deadline - now;
+  if (delta <= 0)
+    return 0;
+  return delta > 0x7fffffff ? 0x7fffffff : static_cast<int>(delta);
+}
+
+void TimerQueue::popExpired(long long now, std::vector<Timer> &expired) {
+  expired.clear();
+  while (heap.empty() == false && heap.top().deadline <= now) {
+    expired.push_back(heap.top());
+    heap.pop();
+  }
+}
+
+bool TimerQueue::empty() const { return heap.empty(); }
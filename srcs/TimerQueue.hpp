@@ -0,0 +1,41 @@
+#ifndef TIMER_QUEUE_HPP
+#define TIMER_QUEUE_HPP
+
+#include <queue>
+#include <vector>
+
+// Min-heap of connection deadlines in milliseconds on the monotonic clock.
+// Entries are never updated in place: the owner keeps the real deadline and
+// re-schedules when a popped entry turns out to be early, so pushing back a
+// keepalive deadline on every request costs nothing.
+class TimerQueue {
+	public:
+	struct Timer {
+		long long deadline;
+		int fd;
+		unsigned long id;
+	};
+
+	private:
+	struct Later {
+		bool operator()(const Timer &a, const Timer &b) const {
+			return a.deadline > b.deadline;
+		}
+	};
+	std::priority_queue<Timer, std::vector<Timer>, Later> heap;
+
+	public:
+	TimerQueue();
+	~TimerQueue();
+
+	static long long now();
+
+	void schedule(int fd, unsigned long id, long long deadline);
+	// Milliseconds until the earliest deadline, -1 when nothing is scheduled
+	int nextTimeout(long long now) const;
+	// Moves every timer due at now into expired, cost is O(expired log n)
+	void popExpired(long long now, std::vector<Timer> &expired);
+	bool empty() const;
+};
+
+#endif // TIMER_QUEUE_HPP
@@ -0,0 +1,131 @@
+#include "UrlPath.hpp"
+#include "Scanner.hpp"
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Applies the segment that starts with the '/' at path[mark]: empty and "."
+// segments vanish, ".." also drops the segment before it
+static bool collapse(std::string &path, size_t mark) {
+  std::string_view segment(path.data() + mark + 1, path.size() - mark - 1);
+  if (segment.empty() == true || segment == ".") {
+    path.resize(mark);
+    return true;
+  }
+  if (segment != "..")
+    return true;
+  path.resize(mark);
+  if (path.empty() == true)
+    return false; // above the root
+  path.resize(path.rfind('/'));
+  return true;
+}
+
+// Walks the '/' separated segments of input into path, decoding each one
+// first when the input is still encoded
+static bool build(std::string_view input, std::string &path, bool encoded) {
+  path.clear();
+  if (input.empty() == true || input[0] != '/')
+    return false;
+  std::string segment;
+  bool directory = false;
+  size_t start = 1;
+  while (true) {
+    size_t end = input.find('/', start);
+    if (end == std::string_view::npos)
+      end = input.size();
+    std::string_view raw = input.substr(start, end - start);
+    if (encoded == true) {
+      if (UrlPath::decode(raw, segment) == false)
+        return false;
+      // An encoded '/' would change the path's structure after the fact
+      if (segment.find('/') != std::string::npos)
+        return false;
+      raw = segment;
+    }
+    if (raw.find('\0') != std::string_view::npos)
+      return false;
+    size_t mark = path.size();
+    path.push_back('/');
+    path.append(raw);
+    if (collapse(path, mark) == false)
+      return false;
+    directory = raw.empty() || raw == "." || raw == "..";
+    if (end == input.size())
+      break;
+    start = end + 1;
+  }
+  // "/a/" and "/a/b/.." name the directory, keep the slash that says so
+  if (path.empty() == true || directory == true)
+    path.push_back('/');
+  return true;
+}
+
+bool UrlPath::split(std::string_view target, std::string &path,
+                    std::string &query) {
+  query.clear();
+  size_t mark = target.find('?');
+  if (mark != std::string_view::npos) {
+    query.assign(target.substr(mark + 1));
+    target = target.substr(0, mark);
+  }
+  return build(target, path, true);
+}
+
+bool UrlPath::normalize(std::string_view decoded, std::string &path) {
+  return build(decoded, path, false);
+}
+
+bool UrlPath::decode(std::string_view encoded, std::string &decoded,
+                     bool form) {
+  decoded.clear();
+  decoded.reserve(encoded.size());
+  size_t start = 0;
+  while (start < encoded.size()) {
+    size_t escape = Scanner::findByte(encoded, '%', start);
+    if (escape == Scanner::npos)
+      escape = encoded.size();
+    size_t literal = decoded.size();
+    decoded.append(encoded.substr(start, escape - start));
+    if (form == true) {
+      for (size_t i = literal; i < decoded.size(); i++) {
+        if (decoded[i] == '+')
+          decoded[i] = ' ';
+      }
+    }
+    if (escape == encoded.size())
+      break;
+    if (escape + 2 >= encoded.size())
+      return false;
+    int high = hexValue(encoded[escape + 1]);
+    int low = hexValue(encoded[escape + 2]);
+    if (high < 0 || low < 0)
+      return false;
+    decoded.push_back(static_cast<char>(high * 16 + low));
+    start = escape + 3;
+  }
+  return true;
+}
+
+std::string_view UrlPath::param(std::string_view query,
+                                std::string_view name) {
+  while (query.empty() == false) {
+    size_t end = query.find('&');
+    std::string_view pair = query.substr(0, end);
+    size_t equals = pair.find('=');
+    if (pair.substr(0, equals) == name)
+      return equals == std::string_view::npos ? std::string_view()
+                                              : pair.substr(equals + 1);
+    if (end == std::string_view::npos)
+      break;
+    query.remove_prefix(end + 1);
+  }
+  return std::string_view();
+}
@@ -0,0 +1,28 @@
+#ifndef URL_PATH_HPP
+#define URL_PATH_HPP
+
+#include <string>
+#include <string_view>
+
+// Request target decoding. A target is split once per request into its
+// decoded, normalized path and its raw query; routing, static files,
+// DELETE and CGI all work from that path. Literal runs are copied whole,
+// the next escape is found with a vectorised scan.
+class UrlPath {
+	public:
+	// Splits target at '?', percent-decodes the path and collapses empty,
+	// "." and ".." segments. False for malformed escapes, NUL or an encoded
+	// '/' in a segment, and ".." above the root.
+	static bool split(std::string_view target, std::string &path,
+	                  std::string &query);
+	// Collapses the segments of an already decoded path, same rules
+	static bool normalize(std::string_view decoded, std::string &path);
+	// Decodes every %XX, form also turns '+' into a space
+	static bool decode(std::string_view encoded, std::string &decoded,
+	                   bool form = false);
+	// Raw value of a query parameter, empty if it is missing
+	static std::string_view param(std::string_view query,
+	                              std::string_view name);
+};
+
+#endif // URL_PATH_HPP
@@ -1,4 +1,8 @@
 #include "Utils.hpp"
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 std::map<std::string, std::string> g_mimeTypes;
 
@@ -28,3 +32,63 @@ bool parseMimeTypes(const std::string &filename) {
   file.close();
   return true;
 }
+
+// Read only lookup, the map is shared by every worker thread once parsed
+std::string getMimeType(const std::string &extension) {
+  std::map<std::string, std::string>::const_iterator it =
+      g_mimeTypes.find(extension);
+  if (it == g_mimeTypes.end())
+    return "";
+  return it->second;
+}
+
+// Read/write file without a name, it disappears with its last descriptor
+int openTempFile() {
+  const char *dir = getenv("TMPDIR");
+  if (dir == NULL || *dir == '\0')
+    dir = "/tmp";
+  int fd = -1;
+#ifdef O_TMPFILE
+  fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+  if (fd != -1)
+    return fd;
+#endif
+  std::string path = std::string(dir) + "/webserv-body-XXXXXX";
+  fd = mkstemp(&path[0]);
+  if (fd == -1)
+    return -1;
+  unlink(path.c_str());
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  return fd;
+}
+
+// IMF-fixdate, the only format a server generates
+std::string httpDate(time_t when) {
+  char buffer[64];
+  struct tm parts;
+  gmtime_r(&when, &parts);
+  strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &parts);
+  return std::string(buffer);
+}
+
+// -1 unless value is an IMF-fixdate; the obsolete formats are not accepted
+time_t parseHttpDate(std::string_view value) {
+  std::string text(value);
+  struct tm parts = {};
+  const char *end = strptime(text.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &parts);
+  if (end == NULL || *end != '\0')
+    return -1;
+  return timegm(&parts);
+}
+
+// Strong validator from the file's identity, it changes with any rewrite
+// without reading the content
+std::string entityTag(const struct stat &info) {
+  char buffer[80];
+  snprintf(buffer, sizeof(buffer), "\"%lx-%llx-%llx\"",
+           static_cast<unsigned long>(info.st_ino),
+           static_cast<unsigned long long>(info.st_size),
+           static_cast<unsigned long long>(info.st_mtim.tv_sec) * 1000000000ULL +
+               info.st_mtim.tv_nsec);
+  return std::string(buffer);
+}
@@ -3,7 +3,15 @@
 
 #include "EventLogger.hpp"
 #include "Structs.hpp"
+#include <ctime>
+#include <string_view>
+#include <sys/stat.h>
 
 bool parseMimeTypes(const std::string &filename);
+std::string getMimeType(const std::string &extension);
+int openTempFile();
+std::string httpDate(time_t when);
+time_t parseHttpDate(std::string_view value);
+std::string entityTag(const struct stat &info);
 
 #endif
@@ -0,0 +1,96 @@
+#include "VhostIndex.hpp"
+
+static const size_t maxHostLength = 255;
+
+static char toLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+static std::string lowerCase(std::string_view name) {
+  std::string lowered(name);
+  for (size_t i = 0; i < lowered.size(); i++)
+    lowered[i] = toLower(lowered[i]);
+  return lowered;
+}
+
+VhostIndex::VhostIndex() {}
+
+VhostIndex::~VhostIndex() {}
+
+void VhostIndex::build(const std::vector<ServerParser> &servers) {
+  byListener.clear();
+  names.clear();
+  std::vector<ServerParser>::const_iterator it;
+  for (it = servers.begin(); it != servers.end(); it++) {
+    Port &port = byListener[it->sockfd];
+    if (port.defaultServer == NULL)
+      port.defaultServer = &*it;
+    // The first block wins when a name is repeated on a port
+    names.push_back(lowerCase(it->server_name));
+    port.byName.insert(std::make_pair(std::string_view(names.back()), &*it));
+  }
+}
+
+const ServerParser *VhostIndex::defaultServer(int listenFd) const {
+  std::unordered_map<int, Port>::const_iterator port =
+      byListener.find(listenFd);
+  if (port == byListener.end())
+    return NULL;
+  return port->second.defaultServer;
+}
+
+const ServerParser *VhostIndex::find(int listenFd,
+                                     std::string_view host) const {
+  std::unordered_map<int, Port>::const_iterator port =
+      byListener.find(listenFd);
+  if (port == byListener.end())
+    return NULL;
+  std::string_view name;
+  if (parseHost(host, name) == false || name.empty() == true)
+    return port->second.defaultServer;
+
+  // parseHost keeps names within maxHostLength
+  char lowered[maxHostLength];
+  for (size_t i = 0; i < name.size(); i++)
+    lowered[i] = toLower(name[i]);
+  std::unordered_map<std::string_view, const ServerParser *>::const_iterator
+      server = port->second.byName.find(
+          std::string_view(lowered, name.size()));
+  if (server == port->second.byName.end())
+    return port->second.defaultServer;
+  return server->second;
+}
+
+// host = reg-name / IPv4 / "[" IPv6 "]", followed by an optional ":" port
+bool VhostIndex::parseHost(std::string_view value, std::string_view &name) {
+  size_t end = 0;
+  if (value.empty() == false && value[0] == '[') {
+    end = value.find(']');
+    if (end == std::string_view::npos)
+      return false;
+    end++;
+  } else {
+    while (end < value.size() && value[end] != ':') {
+      char c = value[end];
+      if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+            (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_'))
+        return false;
+      end++;
+    }
+  }
+  if (end > maxHostLength)
+    return false;
+  if (end < value.size()) {
+    if (value[end] != ':')
+      return false;
+    for (size_t i = end + 1; i < value.size(); i++) {
+      if (value[i] < '0' || value[i] > '9')
+        return false;
+    }
+  }
+  name = value.substr(0, end);
+  // A fully qualified name may end with a dot
+  if (name.size() > 1 && name.back() == '.')
+    name.remove_suffix(1);
+  return true;
+}
@@ -0,0 +1,41 @@
+#ifndef VHOST_INDEX_HPP
+#define VHOST_INDEX_HPP
+
+#include "Structs.hpp"
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+
+// Server block lookup by (listening socket, Host name), built once after the
+// listeners are bound and read-only afterwards. The first server block of a
+// port is its default server, it answers requests whose Host matches no
+// server_name. Entries point into the server vector, which must outlive the
+// index and must not be resized. Names are keyed lowercased, a Host name is
+// lowercased on the stack to look them up.
+class VhostIndex {
+	private:
+	struct Port {
+		const ServerParser *defaultServer;
+		std::unordered_map<std::string_view, const ServerParser *> byName;
+
+		Port() : defaultServer(NULL) {}
+	};
+	std::unordered_map<int, Port> byListener; // keyed by listening fd
+	std::deque<std::string> names; // storage of the byName keys
+
+	VhostIndex(const VhostIndex &);
+	VhostIndex &operator=(const VhostIndex &);
+
+	public:
+	VhostIndex();
+	~VhostIndex();
+
+	void build(const std::vector<ServerParser> &servers);
+	const ServerParser *defaultServer(int listenFd) const;
+	const ServerParser *find(int listenFd, std::string_view host) const;
+
+	// Host name of a Host header value without port, false if malformed
+	static bool parseHost(std::string_view value, std::string_view &name);
+};
+
+#endif // VHOST_INDEX_HPP
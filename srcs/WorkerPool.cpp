@@ -0,0 +1,130 @@
+#include "WorkerPool.hpp"
+
+WorkerPool::WorkerPool(std::vector<ServerParser> servers,
+                       const HttpConfig &http)
+    : servers(servers), http(http), failed(false) {
+  SocketManager::setupSignals();
+  if (http.worker_mode == "process") {
+    runProcesses();
+    return;
+  }
+  if (http.workers <= 1) {
+    SocketManager sockets(servers, http);
+    return;
+  }
+  runThreads();
+}
+
+WorkerPool::~WorkerPool() {}
+
+void WorkerPool::runThread(int id) {
+  INFO("Worker thread " << id << " starting");
+  try {
+    SocketManager sockets(servers, http);
+  } catch (std::exception const &e) {
+    ERROR("Worker thread " << id << ": " << e.what());
+    failed = true;
+    raise(SIGINT); // bring the other workers down too
+  }
+}
+
+// SO_REUSEPORT listeners let each thread accept on the same ports
+void WorkerPool::runThreads() {
+  std::vector<std::thread> threads;
+
+  INFO("Starting " << http.workers << " worker threads");
+  for (int id = 0; id < http.workers; id++)
+    threads.push_back(std::thread(&WorkerPool::runThread, this, id));
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+  if (failed == true)
+    throw std::runtime_error("A worker thread stopped with an error");
+}
+
+// The child never returns into main, it serves until stopped and exits
+pid_t WorkerPool::spawnProcess(int id) {
+  pid_t pid = fork();
+  if (pid == -1) {
+    ERROR("Failed to fork worker " << id << ": " << strerror(errno));
+    return -1;
+  }
+  if (pid > 0) {
+    INFO("Worker process " << id << " started with pid " << pid);
+    return pid;
+  }
+
+  int status = 0;
+  SocketManager::resetSignals();
+  try {
+    SocketManager sockets(servers, http);
+  } catch (std::exception const &e) {
+    ERROR("Worker process " << id << ": " << e.what());
+    status = 1;
+  }
+  exit(status);
+}
+
+void WorkerPool::stopProcesses() {
+  int signum = gStopSignal != 0 ? gStopSignal : SIGTERM;
+
+  for (size_t id = 0; id < workerPids.size(); id++) {
+    if (workerPids[id] > 0)
+      kill(workerPids[id], signum);
+  }
+  for (size_t id = 0; id < workerPids.size(); id++) {
+    if (workerPids[id] > 0)
+      waitpid(workerPids[id], NULL, 0);
+  }
+}
+
+// The master binds every listener once and forks the workers, which inherit
+// them. A worker that dies is replaced, so a crash only drops the
+// connections that worker was serving.
+void WorkerPool::runProcesses() {
+  std::vector<time_t> startTimes(http.workers, 0);
+
+  SocketManager::bindListeners(servers, false);
+  INFO("Starting " << http.workers << " worker processes");
+  workerPids.assign(http.workers, -1);
+  for (int id = 0; id < http.workers; id++) {
+    workerPids[id] = spawnProcess(id);
+    startTimes[id] = std::time(NULL);
+  }
+
+  while (gServerSignal) {
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid == -1) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    std::vector<pid_t>::iterator it =
+        std::find(workerPids.begin(), workerPids.end(), pid);
+    if (it == workerPids.end() || gServerSignal == 0)
+      continue;
+    int id = it - workerPids.begin();
+    if (WIFSIGNALED(status)) {
+      WARNING("Worker " << id << " killed by signal " << WTERMSIG(status));
+    } else {
+      WARNING("Worker " << id << " exited with status "
+                        << WEXITSTATUS(status));
+    }
+    // Do not respawn in a tight loop when a worker dies right at startup
+    if (std::time(NULL) - startTimes[id] < 1)
+      sleep(1);
+    if (gServerSignal == 0)
+      break;
+    workerPids[id] = spawnProcess(id);
+    startTimes[id] = std::time(NULL);
+  }
+
+  stopProcesses();
+  std::set<int> listeners;
+  std::vector<ServerParser>::iterator it;
+  for (it = servers.begin(); it != servers.end(); it++) {
+    if (it->sockfd != -1 && listeners.insert(it->sockfd).second == true)
+      close(it->sockfd);
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include "SocketManager.hpp"
+#include "Structs.hpp"
+#include <atomic>
+#include <sys/wait.h>
+#include <thread>
+
+// Runs one SocketManager per worker, either as threads in this process or as
+// pre-forked processes supervised by this one. Each worker owns its event
+// backend, timers and connection table, nothing mutable is shared between
+// them on the request path.
+class WorkerPool {
+	private:
+	std::vector<ServerParser> servers;
+	HttpConfig http;
+	std::atomic<bool> failed;
+	std::vector<pid_t> workerPids;
+
+	void runThread(int id);
+	pid_t spawnProcess(int id);
+	void stopProcesses();
+
+	public:
+	WorkerPool(std::vector<ServerParser> servers, const HttpConfig &http);
+	~WorkerPool();
+
+	void runThreads();
+	void runProcesses();
+};
+
+#endif // WORKER_POOL_HPP
@@ -2,6 +2,7 @@
 #include "Lexer.hpp"
 #include "Parser.hpp"
 #include "SocketManager.hpp"
+#include "WorkerPool.hpp"
 #include "Utils.hpp"
 #include <exception>
 
@@ -17,7 +18,7 @@ int main(int argc, char *argv[]) {
   try {
     Lexer tokens(configfile_path);
     Parser parser(tokens.getLexer());
-    SocketManager sockets(parser.getParser());
+    WorkerPool workers(parser.getParser(), parser.getHttpConfig());
     // std::cout << sockets.getServers() << std::endl;
   } catch (std::runtime_error const &e) {
     ERROR(e.what());
@@ -0,0 +1,52 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstdio>
+
+// Helpers shared by the microbenchmarks in tools/bench. A case calls its
+// body in growing batches until minSeconds passed and prints calls per second,
+// plus the throughput when every call processes a known number of bytes.
+namespace Bench {
+
+const double minSeconds = 0.3;
+
+// Keeps the compiler from dropping a result nobody reads
+template <typename T> inline void keep(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline double seconds() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+template <typename Body> double rate(Body body) {
+  size_t batch = 1;
+  size_t calls = 0;
+  double start = seconds();
+  double elapsed = 0;
+  do {
+    for (size_t i = 0; i < batch; i++)
+      body();
+    calls += batch;
+    batch *= 2;
+    elapsed = seconds() - start;
+  } while (elapsed < minSeconds);
+  return calls / elapsed;
+}
+
+inline void report(const char *name, double perSecond, size_t bytes = 0) {
+  if (bytes == 0)
+    std::printf("  %-44s %14.0f /s\n", name, perSecond);
+  else
+    std::printf("  %-44s %14.0f /s %9.2f GB/s\n", name, perSecond,
+                perSecond * bytes / 1e9);
+}
+
+inline void title(const char *name) { std::printf("%s\n", name); }
+
+} // namespace Bench
+
+#endif // BENCH_HPP
@@ -0,0 +1,92 @@
+#include "Bench.hpp"
+#include "ConnectionTable.hpp"
+#include <algorithm>
+#include <map>
+#include <random>
+
+// Event dispatch and connection churn at 10k and 100k open connections:
+// the fd-indexed ConnectionTable against the std::map of clientState and
+// the linear fd vectors it replaced
+
+static const int listeners = 4;
+static const size_t eventsPerCall = 1024;
+
+// What SocketManager used to keep: fd lists searched with std::find and a
+// map from fd to client state
+struct MapTable {
+  std::vector<int> serverFds;
+  std::vector<int> clientFds;
+  std::map<int, clientState> clients;
+
+  bool isServerFd(int fd) const {
+    return std::find(serverFds.begin(), serverFds.end(), fd) != serverFds.end();
+  }
+  bool isClientFd(int fd) const {
+    return std::find(clientFds.begin(), clientFds.end(), fd) != clientFds.end();
+  }
+  void add(int fd) {
+    clientFds.push_back(fd);
+    clients[fd].clear();
+  }
+  void remove(int fd) {
+    clients.erase(fd);
+    clientFds.erase(std::find(clientFds.begin(), clientFds.end(), fd));
+  }
+};
+
+static void run(size_t connections) {
+  std::mt19937 random(42);
+  std::vector<int> ready(eventsPerCall);
+  for (size_t i = 0; i < ready.size(); i++)
+    ready[i] = listeners + random() % connections;
+
+  std::printf("%zu connections\n", connections);
+  {
+    MapTable table;
+    for (int fd = 0; fd < listeners; fd++)
+      table.serverFds.push_back(fd);
+    for (size_t i = 0; i < connections; i++)
+      table.add(listeners + i);
+    double calls = Bench::rate([&] {
+      for (size_t i = 0; i < ready.size(); i++) {
+        int fd = ready[i];
+        if (table.isServerFd(fd) == false && table.isClientFd(fd) == true)
+          table.clients[fd].bytesRead++;
+      }
+    });
+    Bench::report("map + fd vectors: dispatch (events)", calls * eventsPerCall);
+    size_t next = 0;
+    Bench::report("map + fd vectors: close + accept", Bench::rate([&] {
+                    int fd = ready[next++ % ready.size()];
+                    table.remove(fd);
+                    table.add(fd);
+                  }));
+  }
+  {
+    ConnectionTable table;
+    for (int fd = 0; fd < listeners; fd++)
+      table.addListener(fd);
+    for (size_t i = 0; i < connections; i++)
+      table.addClient(listeners + i).clear();
+    double calls = Bench::rate([&] {
+      for (size_t i = 0; i < ready.size(); i++) {
+        int fd = ready[i];
+        if (table.typeOf(fd) == FD_CLIENT)
+          table[fd].bytesRead++;
+      }
+    });
+    Bench::report("ConnectionTable: dispatch (events)", calls * eventsPerCall);
+    size_t next = 0;
+    Bench::report("ConnectionTable: close + accept", Bench::rate([&] {
+                    int fd = ready[next++ % ready.size()];
+                    table.remove(fd);
+                    table.addClient(fd).clear();
+                  }));
+  }
+}
+
+int main() {
+  run(10000);
+  run(100000);
+  return 0;
+}
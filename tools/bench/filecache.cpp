@@ -0,0 +1,74 @@
+#include "Bench.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include <cstring>
+
+// GET throughput through requestBlock and respond for the static hot set,
+// with a warm FileCache and with a cold one that has to open, stat and read
+// the file for every request. Uses config/default.config and ./www, so it
+// runs from the repository root; the socket send is not part of it.
+
+struct Connection {
+  BufferPool buffers;
+  clientState client;
+
+  Connection(const VhostIndex &vhosts, int listenFd) {
+    client.clear();
+    client.readBuffer.attach(&buffers);
+    client.listenFd = listenFd;
+    client.serverData = vhosts.defaultServer(listenFd);
+  }
+};
+
+// One request in, one response queued and dropped
+static size_t get(Connection &connection, const VhostIndex &vhosts,
+                  FileCache &cache, const std::string &request) {
+  clientState &client = connection.client;
+  client.readBuffer.reserve();
+  std::memcpy(client.readBuffer.tail(), request.data(), request.size());
+  client.readBuffer.produced(request.size());
+  HttpRequest::requestBlock(client, vhosts);
+  HttpResponse response(cache);
+  response.respond(client);
+  size_t queued = client.output.size();
+  client.output.clear();
+  client.nextRequest();
+  client.readBuffer.shrink();
+  return queued;
+}
+
+int main() {
+  // The server logs to std::cout, the results are printed with printf
+  std::cout.setstate(std::ios::badbit);
+  Lexer tokens("config/default.config");
+  Parser parser(tokens.getLexer());
+  std::vector<ServerParser> servers = parser.getParser();
+  // Blocks sharing a port share a listener, as bindListeners sets it up
+  for (size_t i = 0; i < servers.size(); i++)
+    servers[i].sockfd = 1000 + servers[i].listen;
+  VhostIndex vhosts;
+  vhosts.build(servers);
+  int listenFd = servers.front().sockfd;
+
+  const char *paths[] = {"/index.html", "/styles.css"};
+  for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+    std::string request = "GET " + std::string(paths[i]) +
+                          " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    Connection connection(vhosts, listenFd);
+    FileCache warm(0);
+    size_t bytes = get(connection, vhosts, warm, request);
+    std::printf("GET %s, %zu response bytes\n", paths[i], bytes);
+    Bench::report("cold cache", Bench::rate([&] {
+                    FileCache cold(0);
+                    Bench::keep(get(connection, vhosts, cold, request));
+                  }));
+    Bench::report("hot cache", Bench::rate([&] {
+                    Bench::keep(get(connection, vhosts, warm, request));
+                  }));
+    std::printf("  hit ratio %lu/%lu\n", warm.hits(),
+                warm.hits() + warm.misses());
+  }
+  return 0;
+}
@@ -0,0 +1,266 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// HTTP load generator for the scenarios in tools/bench/load.sh, one thread
+// driving every connection through epoll.
+//
+//   http_load [-p port] [-c connections] [-d seconds] path
+//     keep-alive GETs on every connection for the duration, reports
+//     requests and bytes per second
+//   http_load [-p port] -b connections path
+//     opens that many connections at once, one Connection: close GET each,
+//     reports connections per second until the last one was answered
+
+struct Connection {
+  int fd;
+  bool connected;
+  std::string head;     // response head read so far
+  size_t bodyLeft;      // body bytes still to come, once the head is in
+  bool inBody;
+};
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int openConnection(int port, bool wait) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1)
+    return -1;
+  int enable = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  if (wait == false)
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) == -1 &&
+      errno != EINPROGRESS) {
+    close(fd);
+    return -1;
+  }
+  if (wait == true)
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+  return fd;
+}
+
+static bool sendAll(int fd, const std::string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t count = send(fd, data.data() + sent, data.size() - sent,
+                         MSG_NOSIGNAL);
+    if (count <= 0)
+      return false; // requests are small, a full socket buffer is an error
+    sent += count;
+  }
+  return true;
+}
+
+// Reads what arrived, true with complete set once a whole response is in.
+// False when the connection failed or the status was not 2xx.
+static bool readResponse(Connection &connection, size_t &bytes,
+                         bool &complete, bool &closed) {
+  char buffer[65536];
+  complete = false;
+  closed = false;
+  while (true) {
+    ssize_t count = recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (count == 0) {
+      closed = true;
+      return connection.inBody && connection.bodyLeft == 0;
+    }
+    if (count < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    bytes += count;
+    size_t used = 0;
+    if (connection.inBody == false) {
+      size_t before = connection.head.size();
+      connection.head.append(buffer, count);
+      size_t end = connection.head.find("\r\n\r\n");
+      if (end == std::string::npos)
+        continue;
+      if (connection.head.compare(0, 10, "HTTP/1.1 2") != 0)
+        return false;
+      const char *length = strcasestr(connection.head.c_str(),
+                                      "\r\nContent-Length:");
+      connection.bodyLeft = length ? strtoul(length + 17, NULL, 10) : 0;
+      connection.inBody = true;
+      used = end + 4 - before;
+    }
+    size_t body = count - used;
+    if (body > connection.bodyLeft)
+      body = connection.bodyLeft; // pipelining is not used, nothing follows
+    connection.bodyLeft -= body;
+    if (connection.bodyLeft == 0) {
+      complete = true;
+      connection.head.clear();
+      connection.inBody = false;
+      return true;
+    }
+  }
+}
+
+static int keepAlive(int port, int connections, double seconds,
+                     const std::string &path) {
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost:" +
+                        std::to_string(port) +
+                        "\r\nConnection: keep-alive\r\n\r\n";
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  std::vector<Connection> pool(connections);
+  for (int i = 0; i < connections; i++) {
+    pool[i].fd = openConnection(port, true);
+    pool[i].inBody = false;
+    if (pool[i].fd == -1 || sendAll(pool[i].fd, request) == false) {
+      std::fprintf(stderr, "connect: %s\n", strerror(errno));
+      return 1;
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = i;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, pool[i].fd, &event);
+  }
+
+  size_t responses = 0;
+  size_t bytes = 0;
+  size_t errors = 0;
+  int open = connections;
+  double start = now();
+  double end = start + seconds;
+  std::vector<struct epoll_event> events(connections);
+  while (open > 0) {
+    int ready = epoll_wait(epollFd, events.data(), connections, 1000);
+    for (int i = 0; i < ready; i++) {
+      Connection &connection = pool[events[i].data.u32];
+      bool complete;
+      bool closed;
+      bool ok = readResponse(connection, bytes, complete, closed);
+      if (ok == false || (closed && !complete)) {
+        errors++;
+        closed = true;
+      } else if (complete) {
+        responses++;
+        if (now() < end && sendAll(connection.fd, request) == true)
+          continue;
+        closed = true;
+      }
+      if (closed) {
+        close(connection.fd);
+        open--;
+      }
+    }
+  }
+  double elapsed = now() - start;
+  std::printf("%d connections, %.1fs: %zu requests, %.0f requests/s, "
+              "%.1f MB/s, %zu errors\n",
+              connections, elapsed, responses, responses / elapsed,
+              bytes / elapsed / 1e6, errors);
+  return errors == 0 ? 0 : 1;
+}
+
+static int burst(int port, int connections, const std::string &path) {
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost:" +
+                        std::to_string(port) + "\r\nConnection: close\r\n\r\n";
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  std::vector<Connection> pool(connections);
+  double start = now();
+  for (int i = 0; i < connections; i++) {
+    pool[i].fd = openConnection(port, false);
+    pool[i].connected = false;
+    pool[i].inBody = false;
+    if (pool[i].fd == -1) {
+      std::fprintf(stderr, "socket: %s\n", strerror(errno));
+      return 1;
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLOUT | EPOLLIN;
+    event.data.u32 = i;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, pool[i].fd, &event);
+  }
+
+  size_t done = 0;
+  size_t bytes = 0;
+  size_t errors = 0;
+  int open = connections;
+  std::vector<struct epoll_event> events(1024);
+  while (open > 0) {
+    int ready = epoll_wait(epollFd, events.data(), events.size(), 10000);
+    if (ready == 0)
+      break; // stuck, report what finished
+    for (int i = 0; i < ready; i++) {
+      Connection &connection = pool[events[i].data.u32];
+      if (connection.fd == -1)
+        continue;
+      bool failed = (events[i].events & EPOLLERR) != 0;
+      if (failed == false && connection.connected == false &&
+          (events[i].events & EPOLLOUT)) {
+        connection.connected = true;
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = events[i].data.u32;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+        failed = sendAll(connection.fd, request) == false;
+      }
+      bool complete = false;
+      bool closed = false;
+      if (failed == false && (events[i].events & (EPOLLIN | EPOLLHUP)))
+        failed = readResponse(connection, bytes, complete, closed) == false;
+      if (failed == false && complete == false && closed == false)
+        continue;
+      if (failed || complete == false)
+        errors++;
+      else
+        done++;
+      close(connection.fd);
+      connection.fd = -1;
+      open--;
+    }
+  }
+  double elapsed = now() - start;
+  std::printf("burst of %d connections: %.2fs, %.0f connections/s, "
+              "%zu answered, %zu failed, %d stuck\n",
+              connections, elapsed, done / elapsed, done, errors, open);
+  return errors == 0 && open == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  int port = 8000;
+  int connections = 16;
+  double seconds = 5;
+  int burstSize = 0;
+  int option;
+  while ((option = getopt(argc, argv, "p:c:d:b:")) != -1) {
+    if (option == 'p')
+      port = atoi(optarg);
+    else if (option == 'c')
+      connections = atoi(optarg);
+    else if (option == 'd')
+      seconds = atof(optarg);
+    else if (option == 'b')
+      burstSize = atoi(optarg);
+    else
+      return 2;
+  }
+  if (optind != argc - 1) {
+    std::fprintf(stderr, "usage: %s [-p port] [-c connections] [-d seconds] "
+                         "[-b burst] path\n", argv[0]);
+    return 2;
+  }
+  if (burstSize > 0)
+    return burst(port, burstSize, argv[optind]);
+  return keepAlive(port, connections, seconds, argv[optind]);
+}
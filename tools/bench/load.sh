@@ -0,0 +1,124 @@
+#!/bin/sh
+# Load scenarios: starts webserv on a derived copy of the config, drives it
+# with http_load and stops it again. Run from the repository root:
+#
+#   tools/bench/load.sh [scenario...]       (make bench-load runs them all)
+#
+# WEBSERV and CONFIG point the scenarios at another build and its config,
+# e.g. a worktree of an older commit to compare against.
+
+WEBSERV=${WEBSERV:-./webserv}
+CONFIG=${CONFIG:-config/default.config}
+LOAD=${LOAD:-_obj/bench/http_load}
+SYSCOUNT=${SYSCOUNT:-_obj/bench/syscount.so}
+PORT=8000
+RUN_CONFIG=$(mktemp)
+trap 'rm -f "$RUN_CONFIG"' EXIT
+
+# config [directive value]...: writes the config with those http block
+# directives set
+config() {
+	cp "$CONFIG" "$RUN_CONFIG"
+	while [ $# -ge 2 ]; do
+		sed -i "s/^\([[:space:]]*$1[[:space:]]\+\)[^;]*;/\1$2;/" "$RUN_CONFIG"
+		shift 2
+	done
+}
+
+# start [environment...]: runs the server with those variables set
+start() {
+	env "$@" "$WEBSERV" "$RUN_CONFIG" > /dev/null 2>&1 &
+	SERVER=$!
+	tries=0
+	until "$LOAD" -p $PORT -b 1 / > /dev/null 2>&1; do
+		tries=$((tries + 1))
+		if [ $tries -gt 50 ] || ! kill -0 $SERVER 2> /dev/null; then
+			echo "webserv did not come up" >&2
+			exit 1
+		fi
+		sleep 0.1
+	done
+}
+
+# The stop handler logs, a signal landing inside malloc can hang the server
+stop() {
+	kill -INT $SERVER
+	tries=0
+	while kill -0 $SERVER 2> /dev/null && [ $tries -lt 50 ]; do
+		tries=$((tries + 1))
+		sleep 0.1
+	done
+	kill -KILL $SERVER 2> /dev/null
+	wait $SERVER 2> /dev/null
+}
+
+# Resident memory of the server, anonymous and file-backed pages apart
+memory() {
+	grep -E "^(VmHWM|RssAnon|RssFile)" /proc/$SERVER/status | tr -s '\t ' ' ' |
+		tr '\n' ' '
+	echo
+}
+
+# Connections per second while 10k clients connect at once
+accept() {
+	echo "accept burst, 10000 connections, one GET /index.html each"
+	config workers 1
+	start
+	"$LOAD" -p $PORT -b 10000 /index.html
+	stop
+}
+
+# Keep-alive requests per second on a small static file with 1, 2 and 4
+# event loops, as threads and as pre-forked processes
+workers() {
+	for mode in thread process; do
+		for count in 1 2 4; do
+			echo "workers $count, worker_mode $mode, 64 keep-alive connections, GET /styles.css"
+			config workers $count worker_mode $mode
+			start
+			"$LOAD" -p $PORT -c 64 -d 5 /styles.css
+			stop
+		done
+	done
+}
+
+# Concurrent downloads of a 2.4MB image from one shared mapping, then with
+# mmap turned off so every connection uses sendfile
+mmap() {
+	for threshold in 1000000 0; do
+		echo "mmap_threshold $threshold, 16 keep-alive connections, GET /getimage/hobbit.jpg"
+		config mmap_threshold $threshold
+		start
+		"$LOAD" -p $PORT -c 16 -d 5 /getimage/hobbit.jpg
+		memory
+		stop
+	done
+}
+
+# Keep-alive requests per second on a small static file with each event
+# backend, and the I/O and event syscalls per request made through libc
+backends() {
+	COUNTS=$(mktemp)
+	for backend in poll epoll io_uring; do
+		if [ $backend = io_uring ] && ! grep -q IoUringBackend "$WEBSERV"; then
+			echo "io_uring skipped, webserv was built without it (make IO_URING=1)"
+			continue
+		fi
+		echo "event_backend $backend, 64 keep-alive connections, GET /styles.css"
+		config event_backend $backend workers 1
+		start LD_PRELOAD="$PWD/$SYSCOUNT" SYSCOUNT_FILE="$COUNTS"
+		result=$("$LOAD" -p $PORT -c 64 -d 5 /styles.css)
+		echo "$result"
+		stop
+		requests=$(echo "$result" | sed -n 's/.*: \([0-9]*\) requests,.*/\1/p')
+		awk -v requests="$requests" '$2 > 0 {
+			printf "  %-15s %6.2f per request\n", $1, $2 / requests
+			total += $2
+		} END { printf "  %-15s %6.2f per request\n", "total", total / requests }' "$COUNTS"
+	done
+	rm -f "$COUNTS"
+}
+
+for scenario in ${@:-accept workers mmap backends}; do
+	$scenario || exit 1
+done
@@ -0,0 +1,150 @@
+#include "Bench.hpp"
+#include "HeaderTable.hpp"
+#include "RequestParser.hpp"
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+
+// Requests per second through the request head parser, for a typical
+// browser GET and a header heavy API request, whole and in 64 byte reads.
+// The baseline is the find/substr/istringstream code RequestParser
+// replaced.
+
+static const size_t readSize = 64;
+
+static const char *typical =
+    "GET /styles.css HTTP/1.1\r\n"
+    "Host: localhost:8000\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:127.0) Gecko/20100101 "
+    "Firefox/127.0\r\n"
+    "Accept: text/css,*/*;q=0.1\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Connection: keep-alive\r\n"
+    "Referer: http://localhost:8000/\r\n"
+    "Sec-Fetch-Dest: style\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "\r\n";
+
+static std::string headerHeavy() {
+  std::string head = "POST /api/v1/orders?expand=items HTTP/1.1\r\n"
+                     "Host: api.example.com\r\n"
+                     "Content-Type: application/json\r\n"
+                     "Content-Length: 0\r\n"
+                     "Authorization: Bearer "
+                     "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0NTY3"
+                     "ODkwIiwibmFtZSI6IkpvaG4gRG9lIiwiaWF0IjoxNTE2MjM5MDIyfQ\r\n"
+                     "Cookie: session=4f8c2a1b9d2e1f03; theme=dark; "
+                     "consent=analytics%2Cads; _ga=GA1.1.123456789.1718000000\r\n";
+  for (int i = 0; i < 30; i++)
+    head += "X-Trace-Attribute-" + std::to_string(i) +
+            ": service=checkout;region=eu-central-1;attempt=1\r\n";
+  return head + "\r\n";
+}
+
+/* ------------------------------------------------------------- baseline */
+
+struct OldRequest {
+  std::string readString;
+  std::vector<std::string> requestLine;
+  std::map<std::string, std::string> header;
+  bool headerRead;
+};
+
+static void oldRequestLine(OldRequest &request, const std::string &line) {
+  std::istringstream ss(line);
+  std::string method, url, version;
+  ss >> method >> url >> version;
+  request.requestLine.push_back(method);
+  request.requestLine.push_back(url);
+  request.requestLine.push_back(version);
+}
+
+static void oldRequestHeader(OldRequest &request, const std::string &head) {
+  std::istringstream ss(head);
+  std::string line;
+  while (std::getline(ss, line)) {
+    if (!line.empty() && *line.rbegin() == '\r')
+      line.erase(line.length() - 1);
+    std::size_t pos = line.find(':');
+    if (pos == std::string::npos)
+      continue;
+    std::string key = line.substr(0, pos);
+    std::string value = line.substr(pos + 1);
+    std::string::iterator it = value.begin();
+    while (it != value.end() && std::isspace(*it))
+      ++it;
+    value.erase(value.begin(), it);
+    request.header.insert(std::make_pair(key, value));
+  }
+}
+
+// The old requestBlock: every read searches the whole buffer again
+static void oldBlock(OldRequest &request) {
+  std::string::size_type lineEnd = request.readString.find("\r\n");
+  if (lineEnd == std::string::npos)
+    return;
+  request.requestLine.clear();
+  oldRequestLine(request, request.readString.substr(0, lineEnd));
+  std::string::size_type headEnd = request.readString.find("\r\n\r\n");
+  if (headEnd == std::string::npos || headEnd <= lineEnd + 2)
+    return;
+  oldRequestHeader(request, request.readString.substr(
+                                lineEnd + 2, headEnd - (lineEnd + 2)));
+  request.headerRead = true;
+}
+
+static bool oldParse(const std::string &input, size_t chunk) {
+  OldRequest request;
+  request.headerRead = false;
+  for (size_t at = 0; at < input.size() && !request.headerRead; at += chunk) {
+    request.readString.append(input, at, chunk);
+    oldBlock(request);
+  }
+  return request.headerRead;
+}
+
+/* ---------------------------------------------------------------- parser */
+
+// The parser sees every byte received so far, as it does in requestBlock
+static bool newParse(RequestParser &parser, HeaderTable &headers,
+                     const std::string &input, size_t chunk) {
+  parser.reset();
+  RequestParser::Result result = RequestParser::INCOMPLETE;
+  for (size_t at = 0; at < input.size(); at += chunk) {
+    std::string_view seen(input.data(), std::min(input.size(), at + chunk));
+    result = parser.parse(seen);
+    if (result != RequestParser::INCOMPLETE)
+      break;
+  }
+  if (result != RequestParser::COMPLETE)
+    return false;
+  headers.assign(std::string_view(input).substr(0, parser.length), parser);
+  return true;
+}
+
+static void run(const char *name, const std::string &input) {
+  RequestParser parser;
+  HeaderTable headers;
+  std::printf("%s request, %zu bytes\n", name, input.size());
+  Bench::report("istringstream, whole", Bench::rate([&] {
+                  Bench::keep(oldParse(input, input.size()));
+                }), input.size());
+  Bench::report("istringstream, 64 byte reads", Bench::rate([&] {
+                  Bench::keep(oldParse(input, readSize));
+                }), input.size());
+  Bench::report("RequestParser, whole", Bench::rate([&] {
+                  Bench::keep(newParse(parser, headers, input, input.size()));
+                }), input.size());
+  Bench::report("RequestParser, 64 byte reads", Bench::rate([&] {
+                  Bench::keep(newParse(parser, headers, input, readSize));
+                }), input.size());
+}
+
+int main() {
+  run("Typical", typical);
+  run("Header heavy", headerHeavy());
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include "Bench.hpp"
+#include "Scanner.hpp"
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <string>
+
+// Every Scanner kernel per instruction set against the std::string code it
+// replaced, over 64K inputs that only match at their very end
+
+static const size_t inputSize = 64 * 1024;
+
+// Header lines, the CRLF of each one a candidate for the head end
+static std::string requestHead() {
+  std::string head = "GET /index.html HTTP/1.1\r\n";
+  while (head.size() < inputSize - 4)
+    head += "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n";
+  head.resize(inputSize - 4);
+  return head + "\r\n\r\n";
+}
+
+// Random body bytes ahead of the closing multipart delimiter
+static std::string multipartBody(const std::string &delimiter) {
+  std::mt19937 random(42);
+  std::string body(inputSize - delimiter.size(), '\0');
+  for (size_t i = 0; i < body.size(); i++)
+    body[i] = static_cast<char>(random());
+  return body + delimiter;
+}
+
+static bool isUrlChar(unsigned char c) {
+  return std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' ||
+         c == '/';
+}
+
+int main() {
+  const std::string head = requestHead();
+  const std::string delimiter = "\r\n------WebKitFormBoundary7MA4YWxkTrZu0gW";
+  const std::string body = multipartBody(delimiter);
+  const std::string value = std::string(inputSize - 2, 'a') + "\r\n";
+  const std::string target = std::string(inputSize - 1, 'a') + " ";
+  std::string path;
+  while (path.size() < inputSize)
+    path += "/assets/images/2024/photo-01_thumb.jpg";
+  path.resize(inputSize);
+
+  Bench::title("std::string baseline");
+  Bench::report("find \\r\\n\\r\\n in a request head", Bench::rate([&] {
+                  Bench::keep(head.find("\r\n\r\n"));
+                }), inputSize);
+  Bench::report("find a multipart delimiter", Bench::rate([&] {
+                  Bench::keep(body.find(delimiter));
+                }), inputSize);
+  Bench::report("find a control byte", Bench::rate([&] {
+                  Bench::keep(std::find_if(value.begin(), value.end(),
+                                           [](unsigned char c) {
+                                             return c < 0x20 || c == 0x7f;
+                                           }));
+                }), inputSize);
+  Bench::report("find a space or control byte", Bench::rate([&] {
+                  Bench::keep(std::find_if(target.begin(), target.end(),
+                                           [](unsigned char c) {
+                                             return c <= 0x20 || c == 0x7f;
+                                           }));
+                }), inputSize);
+  Bench::report("check URL characters", Bench::rate([&] {
+                  Bench::keep(std::all_of(path.begin(), path.end(), isUrlChar));
+                }), inputSize);
+
+  const char *isas[] = {"scalar", "sse2", "avx2"};
+  for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); i++) {
+    if (Scanner::useIsa(isas[i]) == false) {
+      std::printf("Scanner %s: not supported by this CPU\n", isas[i]);
+      continue;
+    }
+    std::printf("Scanner %s\n", Scanner::isa());
+    Bench::report("find \\r\\n\\r\\n in a request head", Bench::rate([&] {
+                    Bench::keep(Scanner::find(head, "\r\n\r\n"));
+                  }), inputSize);
+    Bench::report("find a multipart delimiter", Bench::rate([&] {
+                    Bench::keep(Scanner::find(body, delimiter));
+                  }), inputSize);
+    Bench::report("find a control byte", Bench::rate([&] {
+                    Bench::keep(Scanner::findControl(value));
+                  }), inputSize);
+    Bench::report("find a space or control byte", Bench::rate([&] {
+                    Bench::keep(Scanner::findDelimiter(target));
+                  }), inputSize);
+    Bench::report("check URL characters", Bench::rate([&] {
+                    Bench::keep(Scanner::isUrlSafe(path));
+                  }), inputSize);
+  }
+  return 0;
+}
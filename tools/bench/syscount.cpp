@@ -0,0 +1,163 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// LD_PRELOAD library counting the I/O and event syscalls webserv makes
+// through libc. The counts are written to $SYSCOUNT_FILE at exit, one
+// "name count" line each, for tools/bench/load.sh to divide by requests.
+
+enum Call {
+  CALL_ACCEPT, CALL_RECV, CALL_READ, CALL_SEND, CALL_WRITE, CALL_SENDFILE,
+  CALL_CLOSE, CALL_SHUTDOWN, CALL_EPOLL_WAIT, CALL_EPOLL_CTL, CALL_POLL,
+  CALL_IO_URING_ENTER, CALL_OTHER_SYSCALL, CALL_COUNT
+};
+
+static const char *names[CALL_COUNT] = {
+    "accept", "recv", "read", "send", "write", "sendfile", "close",
+    "shutdown", "epoll_wait", "epoll_ctl", "poll", "io_uring_enter",
+    "syscall"};
+static unsigned long counts[CALL_COUNT];
+
+static void count(Call call) {
+  __atomic_fetch_add(&counts[call], 1, __ATOMIC_RELAXED);
+}
+
+template <typename Function> static Function next(const char *name) {
+  return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+}
+
+__attribute__((destructor)) static void report() {
+  const char *path = getenv("SYSCOUNT_FILE");
+  if (path == NULL)
+    return;
+  FILE *file = fopen(path, "w");
+  if (file == NULL)
+    return;
+  for (int i = 0; i < CALL_COUNT; i++)
+    fprintf(file, "%s %lu\n", names[i], counts[i]);
+  fclose(file);
+}
+
+extern "C" {
+
+int accept(int fd, sockaddr *address, socklen_t *length) {
+  count(CALL_ACCEPT);
+  static int (*real)(int, sockaddr *, socklen_t *) =
+      next<int (*)(int, sockaddr *, socklen_t *)>("accept");
+  return real(fd, address, length);
+}
+
+int accept4(int fd, sockaddr *address, socklen_t *length, int flags) {
+  count(CALL_ACCEPT);
+  static int (*real)(int, sockaddr *, socklen_t *, int) =
+      next<int (*)(int, sockaddr *, socklen_t *, int)>("accept4");
+  return real(fd, address, length, flags);
+}
+
+ssize_t recv(int fd, void *buffer, size_t length, int flags) {
+  count(CALL_RECV);
+  static ssize_t (*real)(int, void *, size_t, int) =
+      next<ssize_t (*)(int, void *, size_t, int)>("recv");
+  return real(fd, buffer, length, flags);
+}
+
+ssize_t read(int fd, void *buffer, size_t length) {
+  count(CALL_READ);
+  static ssize_t (*real)(int, void *, size_t) =
+      next<ssize_t (*)(int, void *, size_t)>("read");
+  return real(fd, buffer, length);
+}
+
+ssize_t send(int fd, const void *buffer, size_t length, int flags) {
+  count(CALL_SEND);
+  static ssize_t (*real)(int, const void *, size_t, int) =
+      next<ssize_t (*)(int, const void *, size_t, int)>("send");
+  return real(fd, buffer, length, flags);
+}
+
+ssize_t sendmsg(int fd, const msghdr *message, int flags) {
+  count(CALL_SEND);
+  static ssize_t (*real)(int, const msghdr *, int) =
+      next<ssize_t (*)(int, const msghdr *, int)>("sendmsg");
+  return real(fd, message, flags);
+}
+
+ssize_t write(int fd, const void *buffer, size_t length) {
+  count(CALL_WRITE);
+  static ssize_t (*real)(int, const void *, size_t) =
+      next<ssize_t (*)(int, const void *, size_t)>("write");
+  return real(fd, buffer, length);
+}
+
+ssize_t writev(int fd, const iovec *iov, int count) {
+  ::count(CALL_WRITE);
+  static ssize_t (*real)(int, const iovec *, int) =
+      next<ssize_t (*)(int, const iovec *, int)>("writev");
+  return real(fd, iov, count);
+}
+
+ssize_t sendfile(int out, int in, off_t *offset, size_t length) {
+  count(CALL_SENDFILE);
+  static ssize_t (*real)(int, int, off_t *, size_t) =
+      next<ssize_t (*)(int, int, off_t *, size_t)>("sendfile");
+  return real(out, in, offset, length);
+}
+
+int close(int fd) {
+  count(CALL_CLOSE);
+  static int (*real)(int) = next<int (*)(int)>("close");
+  return real(fd);
+}
+
+int shutdown(int fd, int how) {
+  count(CALL_SHUTDOWN);
+  static int (*real)(int, int) = next<int (*)(int, int)>("shutdown");
+  return real(fd, how);
+}
+
+int epoll_wait(int fd, epoll_event *events, int max, int timeout) {
+  count(CALL_EPOLL_WAIT);
+  static int (*real)(int, epoll_event *, int, int) =
+      next<int (*)(int, epoll_event *, int, int)>("epoll_wait");
+  return real(fd, events, max, timeout);
+}
+
+int epoll_ctl(int fd, int op, int target, epoll_event *event) {
+  count(CALL_EPOLL_CTL);
+  static int (*real)(int, int, int, epoll_event *) =
+      next<int (*)(int, int, int, epoll_event *)>("epoll_ctl");
+  return real(fd, op, target, event);
+}
+
+int poll(pollfd *fds, nfds_t count, int timeout) {
+  ::count(CALL_POLL);
+  static int (*real)(pollfd *, nfds_t, int) =
+      next<int (*)(pollfd *, nfds_t, int)>("poll");
+  return real(fds, count, timeout);
+}
+
+// The io_uring backend has no libc wrappers, it goes through syscall(2)
+long syscall(long number, ...) {
+  count(number == __NR_io_uring_enter ? CALL_IO_URING_ENTER
+                                      : CALL_OTHER_SYSCALL);
+  static long (*real)(long, ...) = next<long (*)(long, ...)>("syscall");
+  va_list args;
+  va_start(args, number);
+  long a = va_arg(args, long);
+  long b = va_arg(args, long);
+  long c = va_arg(args, long);
+  long d = va_arg(args, long);
+  long e = va_arg(args, long);
+  long f = va_arg(args, long);
+  va_end(args);
+  return real(number, a, b, c, d, e, f);
+}
+}
@@ -0,0 +1,67 @@
+#include "Bench.hpp"
+#include "Scanner.hpp"
+#include "UrlPath.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Splitting, decoding and normalizing a corpus of request targets, one URL
+// per line, per Scanner instruction set. The corpus defaults to
+// tools/bench/urls.txt, an access log's worth of targets can be passed in.
+
+// One pass over the corpus, as parseRequestLine does it per request
+static size_t splitAll(const std::vector<std::string> &urls) {
+  std::string path;
+  std::string query;
+  size_t valid = 0;
+  for (size_t i = 0; i < urls.size(); i++)
+    valid += UrlPath::split(urls[i], path, query);
+  return valid;
+}
+
+int main(int argc, char **argv) {
+  const char *corpus = argc > 1 ? argv[1] : "tools/bench/urls.txt";
+  std::ifstream input(corpus);
+  std::vector<std::string> urls;
+  std::string line;
+  size_t bytes = 0;
+  while (std::getline(input, line)) {
+    if (line.empty() == true)
+      continue;
+    urls.push_back(line);
+    bytes += line.size();
+  }
+  if (urls.empty() == true) {
+    std::fprintf(stderr, "No URLs in %s\n", corpus);
+    return 1;
+  }
+
+  // A long form encoded query, as a DELETE or search request carries it
+  std::string form;
+  while (form.size() < 4096)
+    form += "q=http+server+%E6%9D%B1%E4%BA%AC&filter%5Btag%5D=a%20b&";
+  // A long literal run, where the escape scan does the work
+  std::string literal = std::string(4093, 'a') + "%41";
+  std::string decoded;
+
+  std::printf("UrlPath over %zu URLs, %zu bytes, from %s\n", urls.size(),
+              bytes, corpus);
+  const char *isas[] = {"scalar", "sse2", "avx2"};
+  for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); i++) {
+    if (Scanner::useIsa(isas[i]) == false) {
+      std::printf("Scanner %s: not supported by this CPU\n", isas[i]);
+      continue;
+    }
+    std::printf("Scanner %s\n", Scanner::isa());
+    double corpusRate = Bench::rate([&] { Bench::keep(splitAll(urls)); });
+    Bench::report("split corpus (calls = URLs)", corpusRate * urls.size(),
+                  bytes / urls.size());
+    Bench::report("decode a 4K form query", Bench::rate([&] {
+                    Bench::keep(UrlPath::decode(form, decoded, true));
+                  }), form.size());
+    Bench::report("decode a 4K literal run", Bench::rate([&] {
+                    Bench::keep(UrlPath::decode(literal, decoded));
+                  }), literal.size());
+  }
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include "Bench.hpp"
+#include "VhostIndex.hpp"
+#include <regex>
+#include <string>
+
+// Server block selection with 1,000 server blocks on 4 ports, for the first,
+// a middle and the last block of a port and for an unknown name. VhostIndex
+// against the per-request std::regex, linear scan and ServerParser copy it
+// replaced.
+
+static const int blocks = 1000;
+static const int ports = 4;
+
+static std::vector<ServerParser> makeServers() {
+  std::vector<ServerParser> servers(blocks);
+  for (int i = 0; i < blocks; i++) {
+    ServerParser &server = servers[i];
+    server.keepalive_timeout = 15;
+    server.send_timeout = 10;
+    server.listen = 8000 + i % ports;
+    server.sockfd = 100 + i % ports;
+    server.server_name = "site-" + std::to_string(i) + ".example.com";
+    server.root = "./www/site-" + std::to_string(i);
+    server.index = "index.html";
+    server.client_body_size = 1 << 20;
+    const char *paths[] = {"/", "/upload", "/cgi"};
+    for (int j = 0; j < 3; j++) {
+      Location location;
+      location.path = paths[j];
+      location.methods.push_back("GET");
+      location.methods.push_back("POST");
+      location.root = server.root;
+      server.location.push_back(location);
+    }
+  }
+  return servers;
+}
+
+// The old lookup, run for every request
+static bool oldFind(const std::vector<ServerParser> &servers,
+                    const std::string &host, ServerParser &serverData) {
+  std::regex pattern(R"(([^:]+):(\d+))");
+  std::smatch matches;
+  if (std::regex_match(host, matches, pattern) == false)
+    return false;
+  std::string domain = matches[1].str();
+  int port = std::stoi(matches[2].str());
+  for (size_t i = 0; i < servers.size(); i++) {
+    if (servers[i].server_name == domain && servers[i].listen == port) {
+      serverData = servers[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+int main() {
+  std::vector<ServerParser> servers = makeServers();
+  VhostIndex index;
+  index.build(servers);
+  ServerParser serverData;
+
+  // Blocks 0, 500 and 996 all listen on port 8000
+  const int picks[] = {0, blocks / 2, blocks - ports};
+  const char *names[] = {"first block", "middle block", "last block"};
+  std::printf("%d server blocks on %d ports\n", blocks, ports);
+  for (int i = 0; i < 4; i++) {
+    std::string host = i < 3 ? servers[picks[i]].server_name + ":8000"
+                             : std::string("unknown.example.com:8000");
+    std::string label = i < 3 ? names[i] : "unknown name";
+    Bench::report(("regex + scan + copy, " + label).c_str(), Bench::rate([&] {
+                    Bench::keep(oldFind(servers, host, serverData));
+                  }));
+    Bench::report(("VhostIndex, " + label).c_str(), Bench::rate([&] {
+                    Bench::keep(index.find(100, host));
+                  }));
+  }
+  return 0;
+}
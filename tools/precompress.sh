@@ -0,0 +1,33 @@
+#!/bin/sh
+# Writes .gz and .br sidecars next to the text assets under a web root, so
+# the server can send them precompressed. Only missing or stale sidecars
+# are rebuilt, one file per core at a time. brotli is skipped when the
+# brotli tool is not installed.
+#
+# usage: tools/precompress.sh [root]   (default: www)
+
+ROOT=${1:-www}
+JOBS=$(nproc 2>/dev/null || getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+
+if [ ! -d "$ROOT" ]; then
+	echo "precompress: $ROOT is not a directory" >&2
+	exit 1
+fi
+BROTLI=$(command -v brotli || true)
+export BROTLI
+
+# Both tools copy the original's mtime, the server treats a sidecar at least
+# as new as its original as fresh
+find "$ROOT" -type f \( -name '*.html' -o -name '*.htm' -o -name '*.css' \
+	-o -name '*.js' -o -name '*.json' -o -name '*.svg' -o -name '*.txt' \
+	-o -name '*.xml' \) -print0 |
+	xargs -0 -r -n 8 -P "$JOBS" sh -c '
+		for file in "$@"; do
+			if [ ! -f "$file.gz" ] || [ "$file" -nt "$file.gz" ]; then
+				gzip -9 -n -k -f "$file" && echo "  $file.gz"
+			fi
+			if [ -n "$BROTLI" ] && { [ ! -f "$file.br" ] || [ "$file" -nt "$file.br" ]; }; then
+				"$BROTLI" -q 11 -k -f "$file" && echo "  $file.br"
+			fi
+		done
+	' precompress
@@ -0,0 +1,38 @@
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <cstdio>
+
+// Helpers shared by the unit tests in tools/test. CHECK records a failed
+// expectation and goes on, so one run lists every failure; the test binary
+// returns Test::result() and make test stops on the first failing binary.
+// Everything goes to stderr, stdout carries the server's log.
+namespace Test {
+
+inline int failures = 0;
+
+inline void check(bool passed, const char *expression, const char *file,
+                  int line) {
+  if (passed == true)
+    return;
+  std::fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", file, line,
+               expression);
+  failures++;
+}
+
+inline void title(const char *name) { std::fprintf(stderr, "%s\n", name); }
+
+inline int result() {
+  if (failures == 0)
+    std::fprintf(stderr, "  all checks passed\n");
+  else
+    std::fprintf(stderr, "  %d checks failed\n", failures);
+  return failures == 0 ? 0 : 1;
+}
+
+} // namespace Test
+
+#define CHECK(expression)                                                      \
+  Test::check((expression), #expression, __FILE__, __LINE__)
+
+#endif // TEST_HPP
@@ -0,0 +1,164 @@
+#include "HeaderTable.hpp"
+#include "HttpRequest.hpp"
+#include "RequestParser.hpp"
+#include "Test.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+// Request heads through HeaderTable and HttpRequest::requestBlock, for the
+// fields that frame the body: a request whose length two parsers could read
+// differently has to be refused.
+
+static const int listenFd = 100;
+
+static HeaderTable parseHeaders(const std::string &head) {
+  RequestParser parser;
+  HeaderTable headers;
+  if (parser.parse(head) == RequestParser::COMPLETE)
+    headers.assign(head, parser);
+  return headers;
+}
+
+// Feeds the request to requestBlock as a single read would arrive, returns
+// the status it is rejected with, 0 if accepted
+static int requestError(const VhostIndex &vhosts, const std::string &request,
+                         ssize_t *contentLength = NULL) {
+  BufferPool pool;
+  clientState client{};
+  client.clear();
+  client.listenFd = listenFd;
+  client.serverData = vhosts.defaultServer(listenFd);
+  client.readBuffer.attach(&pool);
+  for (size_t at = 0; at < request.size();) {
+    if (client.readBuffer.reserve() == false)
+      return 0;
+    size_t count = std::min(client.readBuffer.space(), request.size() - at);
+    std::memcpy(client.readBuffer.tail(), request.data() + at, count);
+    client.readBuffer.produced(count);
+    at += count;
+  }
+  HttpRequest::requestBlock(client, vhosts);
+  if (contentLength != NULL)
+    *contentLength = client.contentLength;
+  return client.requestError;
+}
+
+static void headerCounts() {
+  Test::title("HeaderTable counts repeated fields");
+  HeaderTable headers = parseHeaders("POST / HTTP/1.1\r\n"
+                                     "Content-Length: 5\r\n"
+                                     "Host: localhost\r\n"
+                                     "content-length: 5\r\n"
+                                     "\r\n");
+  CHECK(headers.count(HEADER_CONTENT_LENGTH) == 2);
+  CHECK(headers.count(HEADER_HOST) == 1);
+  CHECK(headers.count(HEADER_TRANSFER_ENCODING) == 0);
+  CHECK(headers.consistent(HEADER_CONTENT_LENGTH) == true);
+  CHECK(headers.consistent(HEADER_TRANSFER_ENCODING) == true);
+
+  headers = parseHeaders("POST / HTTP/1.1\r\n"
+                         "Content-Length: 5\r\n"
+                         "Content-Length: 6\r\n"
+                         "\r\n");
+  CHECK(headers.count(HEADER_CONTENT_LENGTH) == 2);
+  CHECK(headers.consistent(HEADER_CONTENT_LENGTH) == false);
+  CHECK(headers.get(HEADER_CONTENT_LENGTH) == "5");
+
+  headers.clear();
+  CHECK(headers.count(HEADER_CONTENT_LENGTH) == 0);
+}
+
+static void contentLength(const VhostIndex &vhosts) {
+  Test::title("Content-Length framing");
+  ssize_t length = -1;
+  CHECK(requestError(vhosts,
+                     "POST /upload HTTP/1.1\r\n"
+                     "Host: localhost\r\n"
+                     "Content-Length: 5\r\n"
+                     "\r\n"
+                     "hello",
+                     &length) == 0);
+  CHECK(length == 5);
+
+  length = -1;
+  CHECK(requestError(vhosts,
+                     "POST /upload HTTP/1.1\r\n"
+                     "Host: localhost\r\n"
+                     "Content-Length: 5\r\n"
+                     "Content-Length: 5\r\n"
+                     "\r\n"
+                     "hello",
+                     &length) == 0);
+  CHECK(length == 5);
+
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Content-Length: 5\r\n"
+                             "Content-Length: 6\r\n"
+                             "\r\n"
+                             "hello!") == 400);
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Content-Length: 6\r\n"
+                             "Content-Length: 5\r\n"
+                             "\r\n"
+                             "hello!") == 400);
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Content-Length: 5, 5\r\n"
+                             "\r\n"
+                             "hello") == 400);
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Content-Length: 5,6\r\n"
+                             "\r\n"
+                             "hello") == 400);
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Content-Length: -5\r\n"
+                             "\r\n") == 400);
+}
+
+static void transferEncoding(const VhostIndex &vhosts) {
+  Test::title("Transfer-Encoding framing");
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Transfer-Encoding: chunked\r\n"
+                             "Transfer-Encoding: chunked\r\n"
+                             "\r\n") == 400);
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Transfer-Encoding: gzip\r\n"
+                             "transfer-encoding: chunked\r\n"
+                             "\r\n") == 400);
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Transfer-Encoding: chunked\r\n"
+                             "Content-Length: 5\r\n"
+                             "\r\n") == 400);
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Transfer-Encoding: gzip\r\n"
+                             "\r\n") == 501);
+  CHECK(requestError(vhosts, "POST /upload HTTP/1.1\r\n"
+                             "Host: localhost\r\n"
+                             "Transfer-Encoding: chunked\r\n"
+                             "\r\n"
+                             "5\r\nhello\r\n0\r\n\r\n") == 0);
+}
+
+int main() {
+  std::vector<ServerParser> servers(1);
+  servers[0].listen = 8000;
+  servers[0].sockfd = listenFd;
+  servers[0].server_name = "localhost";
+  servers[0].client_body_size = 1 << 20;
+  VhostIndex vhosts;
+  vhosts.build(servers);
+
+  headerCounts();
+  contentLength(vhosts);
+  transferEncoding(vhosts);
+  return Test::result();
+}
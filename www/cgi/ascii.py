@@ -1,6 +1,7 @@
 #!/usr/bin/env python3
 
 import os
+import sys
 import urllib.parse
 
 # Function to generate ASCII art from text
@@ -56,8 +57,11 @@ def generate_ascii_art(text):
     
     return "\n".join(lines)
 
-# Read the QUERY_STRING environment variable
+# Form fields come from the query string, or from stdin for a POST
 query_string = os.environ.get('QUERY_STRING', '')
+if os.environ.get('REQUEST_METHOD') == 'POST':
+    length = int(os.environ.get('CONTENT_LENGTH') or 0)
+    query_string = sys.stdin.read(length)
 
 # Manually parse the query string
 params = urllib.parse.parse_qs(query_string)